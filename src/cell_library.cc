@@ -0,0 +1,243 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "cell_library.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// -------------------------
+// CellLibrary
+// -------------------------
+// Built-in types.
+//
+CellLibrary::CellLibrary() {
+
+  // Generic Luts like for Zero Asic Z1000/Z1010/Z1060 : K is the 'WIDTH'
+  // parameter.
+  //
+  add(ID($lut), LUT);
+
+  // Xilinx 'xc4v'/'xc7', Lattice 'Mach xo2', Quicklogic 'pp3' Luts
+  //
+  add(ID(LUT1), LUT, 1);
+  add(ID(LUT2), LUT, 2);
+  add(ID(LUT3), LUT, 3);
+  add(ID(LUT4), LUT, 4);
+  add(ID(LUT5), LUT, 5);
+  add(ID(LUT6), LUT, 6);
+  add(ID(INV), LUT, 1);
+  add(ID(MUXF5), LUT | CARRY);
+  add(ID(MUXF6), LUT | CARRY);
+  add(ID(MUXF7), LUT | CARRY);
+  add(ID(MUXF8), CARRY);
+  add(ID(MUXCY), CARRY);
+  add(ID(XORCY), CARRY);
+
+  // ice40 'hx' Luts, carry cells
+  //
+  add(ID(SB_LUT4), LUT, 4);
+  add(ID(SB_CARRY), LUT | CARRY);
+
+  // Microchip 'polarfire' Luts
+  //
+  add(ID(CFG1), LUT, 1);
+  add(ID(CFG2), LUT, 2);
+  add(ID(CFG3), LUT, 3);
+  add(ID(CFG4), LUT, 4);
+
+  // Intel 'cycloneiv' Luts
+  //
+  add(ID($not), LUT, 1);
+  add(ID(cycloneiv_lcell_comb), LUT, 4);
+
+  // Quicklogic 'pp3' muxes : equivalent to 3 and 7 LUT3 (Mux)
+  //
+  add(ID(mux4x0), LUT, 0, 3);
+  add(ID(mux8x0), LUT, 0, 7);
+
+  // Zero Asic Z1000/Z1010/Z1060 DFFs
+  //
+  for (auto type : {ID(dffer), ID(dffes), ID(dffe), ID(dffr), ID(dffs),
+                    ID(dff), ID(dffh), ID(dffeh), ID(dffl), ID(dffel),
+                    ID(dffhl), ID(dffehl)}) {
+    add(type, FF);
+  }
+
+  // Xilinx 'xc4v'/'xc7', Lattice 'Mach xo2', ice40 'hx', Quicklogic 'pp3',
+  // Microchip 'polarfire', Intel 'cycloneiv' DFFs and the rest of the world
+  //
+  for (auto type :
+       {ID(FDCE), ID(FDPE), ID(FDRE), ID(FDRE_1), ID(FDSE), ID(LDCE),
+        ID(TRELLIS_FF), ID(SB_DFF), ID(SB_DFFE), ID(SB_DFFER), ID(SB_DFFESR),
+        ID(SB_DFFESS), ID(SB_DFFN), ID(SB_DFFR), ID(SB_DFFS), ID(SB_DFFSR),
+        ID(SB_DFFES), ID(SB_DFFRS), ID(SB_DFFRR), ID(SB_DFFSS), ID(dffepc),
+        ID(SLE), ID(dffeas), ID(dffer_pxp), ID(dffes_xpp)}) {
+    add(type, FF);
+  }
+
+  // Xilinx xc4v, xc5v, Ice40, Microchip DSPs
+  //
+  for (auto type :
+       {ID(DSP48), ID(DSP48E), ID(DSP48E1), ID(SB_MAC16), ID(MACC_PA)}) {
+    add(type, DSP);
+  }
+
+  // Zero Asic DSPs must be in sync. with :
+  //    wildebeest/architecture/z1010/dsp/zeroasic_dsp_map_mode.v
+  //
+  for (auto type : {ID(efpga_adder), ID(efpga_acc), ID(efpga_mult),
+                    ID(efpga_mult_addc), ID(efpga_macc_pipe),
+                    ID(efpga_macc)}) {
+    add(type, DSP);
+  }
+
+  for (auto type :
+       {ID(efpga_adder_regi), ID(efpga_adder_rego), ID(efpga_adder_regio),
+        ID(efpga_acc_regi), ID(efpga_mult_regi), ID(efpga_mult_rego),
+        ID(efpga_mult_regio), ID(efpga_mult_addc_regi),
+        ID(efpga_mult_addc_rego), ID(efpga_mult_addc_regio),
+        ID(efpga_macc_pipe_regi), ID(efpga_macc_regi)}) {
+    add(type, DSP | CLOCKED);
+  }
+
+  // Xilinx xc4v, xc7, Ice40, Lattice xo2, Intel cycloneiv, Microchip BRAMs
+  //
+  for (auto type : {ID(RAMB16), ID(RAM32M), ID(SB_RAM40_4K), ID(DP8KC),
+                    ID(altsyncram), ID(RAM1K20), ID(RAM64x12)}) {
+    add(type, BRAM);
+  }
+
+  // Zero Asic RAMs from 'architecture/z1010/bram/techmap.v' and old RAM
+  // names
+  //
+  for (auto type :
+       {ID(spram_512x32), ID(spram_1024x16), ID(spram_2048x8),
+        ID(spram_4096x4), ID(spram_8192x2), ID(spram_16384x1),
+        ID(sdpram_1024x16), ID(sdpram_2048x8), ID(sdpram_4096x4),
+        ID(sdpram_8192x2), ID(sdpram_16384x1), ID(tdpram_1024x16),
+        ID(tdpram_2048x8), ID(tdpram_4096x4), ID(tdpram_8192x2),
+        ID(tdpram_16384x1), ID(spram_512x64), ID(spram_1024x32),
+        ID(spram_2048x16), ID(spram_4096x8), ID(spram_8192x4),
+        ID(spram_16384x2), ID(spram_32768x1), ID(sdpram_1024x32),
+        ID(sdpram_2048x16), ID(sdpram_4096x8), ID(sdpram_8192x4),
+        ID(sdpram_16384x2), ID(sdpram_32768x1), ID(tdpram_1024x32),
+        ID(tdpram_2048x16), ID(tdpram_4096x8), ID(tdpram_8192x4),
+        ID(tdpram_16384x2), ID(tdpram_32768x1)}) {
+    add(type, BRAM);
+  }
+
+  // Xilinx and Microchip IO and clock buffers
+  //
+  for (auto type :
+       {ID(IBUF), ID(OBUF), ID(INBUF), ID(OUTBUF), ID(CLKINT)}) {
+    add(type, IO);
+  }
+  add(ID(IBUF), THROUGH);
+  add(ID(OBUF), THROUGH);
+}
+
+// -------------------------
+// CellLibrary::get
+// -------------------------
+//
+CellLibrary &CellLibrary::get() {
+  static CellLibrary library;
+  return library;
+}
+
+// -------------------------
+// CellLibrary::reset
+// -------------------------
+//
+void CellLibrary::reset() { *this = CellLibrary(); }
+
+// -------------------------
+// CellLibrary::add
+// -------------------------
+// Roles of a type given several times are merged.
+//
+void CellLibrary::add(RTLIL::IdString type, int roles, int lut_size,
+                      int lut_weight) {
+  CellInfo &info = types[type];
+
+  info.roles |= roles;
+
+  if (roles & LUT) {
+    info.lut_size = lut_size;
+    info.lut_weight = lut_weight;
+  }
+}
+
+// -------------------------
+// CellLibrary::read_config
+// -------------------------
+//
+void CellLibrary::read_config(JsonNode *cells,
+                              const std::string &config_file) {
+  if (cells->type != 'D') {
+    log_error("'cells' must be a dictionary in config file '%s'.\n",
+              config_file.c_str());
+  }
+
+  static const dict<std::string, int> sections = {
+      {"ff", FF},
+      {"dsp", DSP},
+      {"clocked_dsp", DSP | CLOCKED},
+      {"bram", BRAM},
+      {"io", IO}};
+
+  for (auto &it : cells->data_dict) {
+
+    if (it.first == "lut") {
+
+      if (it.second->type != 'D') {
+        log_error("'lut' from 'cells' must be a dictionary.\n");
+      }
+
+      for (auto &lut : it.second->data_dict) {
+        if (lut.second->type != 'N') {
+          log_error("LUT size of '%s' must be an integer.\n",
+                    lut.first.c_str());
+        }
+        add(RTLIL::escape_id(lut.first), LUT, lut.second->data_number);
+      }
+      continue;
+    }
+
+    if (!sections.count(it.first)) {
+      log_warning("Unknown '%s' entry in 'cells' of config file '%s'.\n",
+                  it.first.c_str(), config_file.c_str());
+      continue;
+    }
+
+    if (it.second->type != 'A') {
+      log_error("'%s' from 'cells' must be an array.\n", it.first.c_str());
+    }
+
+    for (auto type : it.second->data_array) {
+      if (type->type != 'S') {
+        log_error("Array associated to '%s' from 'cells' must contain only "
+                  "strings.\n",
+                  it.first.c_str());
+      }
+      add(RTLIL::escape_id(type->data_string), sections.at(it.first));
+    }
+  }
+}
+
+YOSYS_NAMESPACE_END
@@ -0,0 +1,135 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef CELL_LIBRARY_H
+#define CELL_LIBRARY_H
+
+#include "kernel/yosys.h"
+#include "json_node.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Roles of the technology cell types, shared by all the passes of the
+// plugin to classify cells ('stat' counts, timing graphs, fanout splitting).
+//
+// The built-in types cover the Zero Asic parts (Z1000/Z1010/Z1060) and the
+// other vendors the plugin is tested with. A config file can add types with
+// its 'cells' section (see 'read_config'), 'synth_fpga' resets the library
+// to the built-in types before reading its config.
+//
+struct CellLibrary {
+
+  enum Role {
+    LUT = 1,         // counted as LUTs
+    CARRY = 2,       // carry chain and wide mux cells, traversed with LUTs
+    FF = 4,          // DFFs and latches
+    DSP = 8,
+    BRAM = 16,
+    IO = 32,         // IO and clock buffers
+    CLOCKED = 64,    // DSPs with registers
+    THROUGH = 128    // buffers traversed with LUTs (Xilinx IBUF/OBUF)
+  };
+
+  struct CellInfo {
+    int roles = 0;
+    int lut_size = 0;   // K of a LUT, 0 if given by its parameters
+    int lut_weight = 0; // LUT equivalent count
+  };
+
+  dict<RTLIL::IdString, CellInfo> types;
+
+  // Return the library, built with the built-in types on first call.
+  //
+  static CellLibrary &get();
+
+  // Back to the built-in types only.
+  //
+  void reset();
+
+  void add(RTLIL::IdString type, int roles, int lut_size = 0,
+           int lut_weight = 1);
+
+  // Add the types of the 'cells' section of a config file :
+  //
+  //    "cells": {
+  //      "lut": { "<type>": <K>, ... },
+  //      "ff": [ "<type>", ... ],
+  //      "dsp": [ ... ], "clocked_dsp": [ ... ], "bram": [ ... ],
+  //      "io": [ ... ]
+  //    }
+  //
+  void read_config(JsonNode *cells, const std::string &config_file);
+
+  const CellInfo &info(RTLIL::IdString type) const {
+    static const CellInfo none;
+    auto it = types.find(type);
+    return (it == types.end()) ? none : it->second;
+  }
+
+  bool has(RTLIL::IdString type, int roles) const {
+    return (info(type).roles & roles) != 0;
+  }
+
+  bool is_lut(RTLIL::IdString type) const { return has(type, LUT); }
+  int lut_weight(RTLIL::IdString type) const {
+    return is_lut(type) ? info(type).lut_weight : 0;
+  }
+  int lut_size(RTLIL::IdString type) const { return info(type).lut_size; }
+
+  // Yosys internal fine grained DFFs are DFFs too.
+  //
+  bool is_dff(RTLIL::IdString type) const {
+    return has(type, FF) || type.begins_with("$_DFF") ||
+           type.begins_with("$_SDFF");
+  }
+
+  bool is_dsp(RTLIL::IdString type) const { return has(type, DSP); }
+  bool is_bram(RTLIL::IdString type) const { return has(type, BRAM); }
+  bool is_io(RTLIL::IdString type) const { return has(type, IO); }
+
+  // Cells traversed by the LUT height computations ('max_height').
+  // Xilinx IBUF/OBUF are traversed as the historical 'max_height' did, so
+  // the heights of Xilinx netlists count their IO buffers.
+  //
+  bool is_lut_logic(RTLIL::IdString type) const {
+    return has(type, LUT | CARRY | THROUGH);
+  }
+
+  // Clock ports of the clocked cells : Yosys internal DFFs, the DFFs, BRAMs
+  // and DSPs of the parts.
+  //
+  static bool is_clock_port(RTLIL::IdString port) {
+    return port.in(ID(clk), ID(CLK), ID::C, ID(CK), ID(CLOCK), ID(W_CLK),
+                   ID(R_CLK), ID(WCLK), ID(RCLK), ID(CLKA), ID(CLKB),
+                   ID(A_CLK), ID(B_CLK), ID(clk0), ID(CLK0), ID(CLK1));
+  }
+
+  // Cells the timing paths start and end at ('max_level -clk2clk') :
+  // DFFs, BRAMs, clocked DSPs and IO buffers.
+  //
+  bool is_cut_point(RTLIL::IdString type) const {
+    return has(type, FF | BRAM | CLOCKED | IO);
+  }
+
+private:
+  CellLibrary();
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
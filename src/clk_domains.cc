@@ -1,14 +1,65 @@
 #include "kernel/celltypes.h"
 #include "kernel/sigtools.h"
 #include "kernel/yosys.h"
+#include "cell_library.h"
+#include "timing_graph.h"
 #include <cassert>
 #include <chrono>
+#include <fstream>
+#include <queue>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 static bool clk2clk = false;
 static bool summary = false;
+static int nb_threads = 1;
+static bool incremental = false;
+static bool use_delays = false;
+
+// Cell delays from the 'timing' section of a config file (-delays) :
+//
+//   "timing": {
+//     "period": 5.0,
+//     "default": 1.0,
+//     "cells": {
+//       "$lut": 0.6,
+//       "dffr": {"clk_to_q": 0.3, "setup": 0.1},
+//       "efpga_mult": {"default": 3.0, "A->P": 4.2, "B->P": 4.2}
+//     }
+//   }
+//
+// An arc takes its 'A->P' entry, else the clock to Q delay if it starts
+// at a clock port, else the cell delay, else the default delay.
+//
+struct DelayModel {
+  float period = 0; // no required times if 0
+  float default_delay = 1;
+  dict<IdString, float> cell_delay;
+  dict<IdString, float> clk_to_q;
+  dict<IdString, float> setup;
+  dict<tuple<IdString, IdString, IdString>, float> arc_delay;
+
+  float arc(IdString type, IdString from, IdString to, bool from_clock) const {
+    auto arc_it = arc_delay.find(tuple<IdString, IdString, IdString>(type, from, to));
+
+    if (arc_it != arc_delay.end()) {
+      return arc_it->second;
+    }
+
+    if (from_clock && clk_to_q.count(type)) {
+      return clk_to_q.at(type);
+    }
+
+    auto cell_it = cell_delay.find(type);
+
+    return (cell_it != cell_delay.end()) ? cell_it->second : default_delay;
+  }
+};
+
+static DelayModel delay_model;
+static int topk = 0;
+static string json_file;
 
 struct MaxLvlPass : public ScriptPass {
 
@@ -17,496 +68,722 @@ struct MaxLvlPass : public ScriptPass {
   struct MaxLvlWorker {
     RTLIL::Design *design;
     RTLIL::Module *module;
-    SigMap sigmap;
 
-    // Bit info attached to a SigBit:
-    //    - level
-    //    - sigBit
-    //    - driven cell from the sigbit
-    //    - heigth
+    // Bit graph over the traversable cells, with the level, heigth and
+    // critical path driver of each bit, and the SigMap it is built with.
+    // They are shared through the design 'TimingMonitor' cache, except with
+    // -delays.
     //
-    dict<SigBit, tuple<int, SigBit, Cell *, int>> bits;
-
-    // Traversal table : from a sigBit gives the fanout
-    // SigBits
-    //
-    dict<SigBit, dict<SigBit, Cell *>> bit2bits;
+    SigMap own_sigmap;
+    SigMap &sigmap;
+    TimingGraph own_graph;
+    TimingGraph &graph;
 
     dict<SigBit, tuple<SigBit, Cell *>> bit2ff;
 
-    pool<SigBit> cps;
-    pool<SigBit> driven_bits;
+    int nb_cps;
+    int nb_driven_bits;
 
     int maxlvl;
     int max_heigth;
-    SigBit maxbit;
-
-    pool<SigBit> visited_bits;
-
-    // ---------------------------------------
-    // setup_internals_zeroasic_clocked_cells
-    // ---------------------------------------
-    void setup_internals_zeroasic_clocked_cells(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(dffehl), {}, {});
-      ff_celltypes.setup_type(ID(dffeh), {}, {});
-      ff_celltypes.setup_type(ID(dffel), {}, {});
-      ff_celltypes.setup_type(ID(dffer), {}, {});
-      ff_celltypes.setup_type(ID(dffes), {}, {});
-      ff_celltypes.setup_type(ID(dffe), {}, {});
-      ff_celltypes.setup_type(ID(dffhl), {}, {});
-      ff_celltypes.setup_type(ID(dffh), {}, {});
-      ff_celltypes.setup_type(ID(dffl), {}, {});
-      ff_celltypes.setup_type(ID(dffr), {}, {});
-      ff_celltypes.setup_type(ID(dffs), {}, {});
-      ff_celltypes.setup_type(ID(dff), {}, {});
-
-      // Clocked DSPs
-      //
-      ff_celltypes.setup_type(ID(efpga_adder_regi), {}, {});
-      ff_celltypes.setup_type(ID(efpga_adder_rego), {}, {});
-      ff_celltypes.setup_type(ID(efpga_adder_regio), {}, {});
+    int maxnode;
 
-      ff_celltypes.setup_type(ID(efpga_acc_regi), {}, {});
-
-      ff_celltypes.setup_type(ID(efpga_mult_regi), {}, {});
-      ff_celltypes.setup_type(ID(efpga_mult_rego), {}, {});
-      ff_celltypes.setup_type(ID(efpga_mult_regio), {}, {});
-
-      ff_celltypes.setup_type(ID(efpga_macc_regi), {}, {});
-      ff_celltypes.setup_type(ID(efpga_macc_pipe_regi), {}, {});
+    // Clock domains (-clk2clk) : clock nets of the clocked cells, the
+    // domain launching the bits driven by clocked cells and the
+    // (bit, domain) endpoints captured by them.
+    //
+    vector<SigBit> clocks;
+    dict<SigBit, int> clock_ids;
+    dict<SigBit, int> bit2launch;
+    dict<SigBit, Cell *> launch_cells;
+    vector<pair<SigBit, int>> endpoints;
 
-      ff_celltypes.setup_type(ID(efpga_mult_addc_regio), {}, {});
-      ff_celltypes.setup_type(ID(efpga_mult_addc_regi), {}, {});
-      ff_celltypes.setup_type(ID(efpga_mult_addc_rego), {}, {});
-    }
+    // Module report in JSON (-json), once run.
+    //
+    string json;
 
-    // ------------------------------------
-    // setup_internals_xilinx_ff_xc4v
-    // ------------------------------------
-    void setup_internals_xilinx_ff_xc4v(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(FDCE), {}, {});
-      ff_celltypes.setup_type(ID(FDPE), {}, {});
-      ff_celltypes.setup_type(ID(FDRE), {}, {});
-      ff_celltypes.setup_type(ID(FDRE_1), {}, {});
-      ff_celltypes.setup_type(ID(FDSE), {}, {});
-      ff_celltypes.setup_type(ID(LDCE), {}, {});
-    }
-    void setup_internals_xilinx_io_xc4v(CellTypes &ff_celltypes) {
-      ff_celltypes.setup_type(ID(IBUF), {}, {});
-      ff_celltypes.setup_type(ID(OBUF), {}, {});
-    }
-    void setup_internals_xilinx_bram(CellTypes &ff_celltypes) {
-      ff_celltypes.setup_type(ID(RAMB16), {}, {});
-      ff_celltypes.setup_type(ID(RAM32M), {}, {});
-      ff_celltypes.setup_type(ID(RAM64x12), {}, {});
-      ff_celltypes.setup_type(ID(OBUF), {}, {});
-    }
+    // ---------------------
+    // get_clock_domain
+    // ---------------------
+    // Domain of the clock net of a clocked cell, -1 if its clock port is
+    // unknown. For cells with several clocks (ex: BRAM read and write
+    // clocks) the first clock port connected gives the domain.
+    //
+    int get_clock_domain(Cell *cell) {
+      for (auto &conn : cell->connections()) {
 
-    // ------------------------------------
-    // setup_internals_lattice_ff_xo2
-    // ------------------------------------
-    void setup_internals_lattice_ff_xo2(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(TRELLIS_FF), {}, {});
-    }
-    void setup_internals_lattice_bram_xo2(CellTypes &ff_celltypes) {
-      // Simply list the BRAM cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(DP8KC), {}, {});
-    }
+        if (!CellLibrary::is_clock_port(conn.first) ||
+            conn.second.empty()) {
+          continue;
+        }
 
-    // ------------------------------------
-    // setup_internals_ice40_ff_hx
-    // ------------------------------------
-    void setup_internals_ice40_ff_hx(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(SB_DFF), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFE), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFER), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFESR), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFESS), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFN), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFR), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFRS), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFRR), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFS), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFSS), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFSR), {}, {});
-      ff_celltypes.setup_type(ID(SB_DFFES), {}, {});
-    }
+        SigBit clock = sigmap(conn.second[0]);
 
-    // ------------------------------------
-    // setup_internals_quicklogic_ff_pp3
-    // ------------------------------------
-    void setup_internals_quicklogic_ff_pp3(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(dffepc), {}, {});
-    }
+        if (!clock_ids.count(clock)) {
+          clock_ids[clock] = GetSize(clocks);
+          clocks.push_back(clock);
+        }
 
-    // ---------------------------------------
-    // setup_internals_microchip_ff_polarfire
-    // ---------------------------------------
-    void setup_internals_microchip_ff_polarfire(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(SLE), {}, {});
-    }
-    void setup_internals_microchip_bram_polarfire(CellTypes &ff_celltypes) {
-      // Simply list the BRAM cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(RAM1K20), {}, {});
-    }
-    void setup_internals_microchip_cells_polarfire(CellTypes &ff_celltypes) {
-      // Simply list the cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(INBUF), {}, {});
-      ff_celltypes.setup_type(ID(OUTBUF), {}, {});
-      ff_celltypes.setup_type(ID(SLE), {}, {});
-      ff_celltypes.setup_type(ID(CLKINT), {}, {});
-    }
+        return clock_ids.at(clock);
+      }
 
-    // ------------------------------------
-    // setup_internals_intel_ff_cycloneiv
-    // ------------------------------------
-    void setup_internals_intel_ff_cycloneiv(CellTypes &ff_celltypes) {
-      // Simply list the DFF cells names is enough as cut points
-      //
-      ff_celltypes.setup_type(ID(dffeas), {}, {});
+      return -1;
     }
 
     // ---------------------
     // MaxLvlWorker
     // ---------------------
     MaxLvlWorker(RTLIL::Module *module)
-        : design(module->design), module(module), sigmap(module) {
+        : design(module->design), module(module),
+          sigmap(use_delays ? own_sigmap
+                            : TimingMonitor::get(module->design)->sigmap(module)),
+          graph(use_delays ? own_graph
+                           : TimingMonitor::get(module->design)
+                                 ->graph(module, graph_kind())) {
+      if (use_delays) {
+        own_sigmap.set(module);
+      }
+
       CellTypes ff_celltypes;
 
       if (clk2clk) { // define cells that are cutpoints during the traversal.
 
         ff_celltypes.setup_internals_mem();
         ff_celltypes.setup_stdcells_mem();
+      }
 
-        // Specify technology related DFF cutpoints for -clk2clk option
-        //
-        setup_internals_zeroasic_clocked_cells(ff_celltypes);
+      // The clocked cells (Yosys internal ones in 'ff_celltypes' and the
+      // technology ones from the 'CellLibrary') are cut points : they are
+      // not traversable and their inputs and outputs are the endpoints and
+      // startpoints of the paths.
+      //
+      auto traversable = [&](Cell *cell) {
+        return !clk2clk || !(ff_celltypes.cell_known(cell->type) ||
+                             CellLibrary::get().is_cut_point(cell->type));
+      };
+
+      if (clk2clk) {
+        for (auto cell : module->selected_cells()) {
+          if (!traversable(cell)) {
+            add_clocked_cell(cell);
+          }
+        }
+      }
 
-        // Xilinx
-        //
-        setup_internals_xilinx_ff_xc4v(ff_celltypes);
-        setup_internals_xilinx_bram(ff_celltypes);
-        setup_internals_xilinx_io_xc4v(ff_celltypes);
+      if (use_delays) {
+        graph.arc_delay = [](Cell *cell, IdString from, IdString to) {
+          return delay_model.arc(cell->type, from, to,
+                                 CellLibrary::is_clock_port(from));
+        };
+      }
 
-        // Lattice
-        //
-        setup_internals_lattice_ff_xo2(ff_celltypes);
-        setup_internals_lattice_bram_xo2(ff_celltypes);
+      if (use_delays) {
+        graph.build(module, sigmap, traversable);
+        graph.levelize(nb_threads);
+      } else {
+        TimingMonitor::get(design)->levelize(module, graph_kind(), traversable,
+                                             false, nb_threads, incremental);
+      }
 
-        // ICE40
-        //
-        setup_internals_ice40_ff_hx(ff_celltypes);
+      maxlvl = -1;
+      maxnode = -1;
+    }
 
-        // QuickLogic
-        //
-        setup_internals_quicklogic_ff_pp3(ff_celltypes);
+    // ---------------------
+    // graph_kind
+    // ---------------------
+    // Key of the graph in the 'TimingMonitor' : the traversable cells
+    // depend on -clk2clk.
+    //
+    static string graph_kind() {
+      return clk2clk ? "max_level -clk2clk" : "max_level";
+    }
 
-        // Microchip
-        //
-        setup_internals_microchip_ff_polarfire(ff_celltypes);
-        setup_internals_microchip_bram_polarfire(ff_celltypes);
-        setup_internals_microchip_cells_polarfire(ff_celltypes);
+    // ---------------------
+    // add_clocked_cell
+    // ---------------------
+    void add_clocked_cell(Cell *cell) {
+      pool<SigBit> src_bits, dst_bits, clock_bits;
 
-        // Intel (Altera)
-        //
-        setup_internals_intel_ff_cycloneiv(ff_celltypes);
+      for (auto &conn : cell->connections()) {
+
+        for (auto bit : sigmap(conn.second)) {
+
+          if (cell->input(conn.first)) {
+            src_bits.insert(bit);
+          }
+
+          if (cell->output(conn.first)) {
+            dst_bits.insert(bit);
+          }
+
+          if (CellLibrary::is_clock_port(conn.first)) {
+            clock_bits.insert(bit);
+          }
+        }
       }
 
-      // For all SigBits create their associated 'bitInfo'
-      // to store <level, from bit, Cell>
-      //
-      for (auto wire : module->selected_wires()) {
+      for (auto s : src_bits) {
+
+        for (auto d : dst_bits) {
+          bit2ff[s] = tuple<SigBit, Cell *>(d, cell);
+          break;
+        }
+      }
+
+      for (auto d : dst_bits) {
+        launch_cells[d] = cell;
+      }
 
-        for (auto bit : sigmap(wire)) {
+      int domain = get_clock_domain(cell);
+
+      if (domain < 0) {
+        return;
+      }
 
-          bits[bit] =
-              tuple<int, SigBit, Cell *, int>(-1, State::Sx, nullptr, -1);
+      for (auto s : src_bits) {
+        if (!clock_bits.count(s)) {
+          endpoints.push_back({s, domain});
         }
       }
 
-      // For all the traversable cells (not in 'ff_celltypes')
-      // add the 'src' bits to 'dest_bits( relationship into the
-      // traversable table 'bit2bits'.
-      //
-      for (auto cell : module->selected_cells()) {
+      for (auto d : dst_bits) {
+        bit2launch[d] = domain;
+      }
+    }
+
+    // ---------------------
+    // get_path
+    // ---------------------
+    // Walk back the 'from' bits, e.g the SigBits on the critical path
+    // driving the cells. The path is returned from Input to Output.
+    //
+    vector<int> get_path(int node) {
+      vector<int> path = {node};
+
+      while (graph.from[path.back()] >= 0) {
+        path.push_back(graph.from[path.back()]);
+      }
 
-        pool<SigBit> src_bits, dst_bits;
+      std::reverse(path.begin(), path.end());
 
-        // For the current Cell 'cell' build the 'src_bits'
-        // to the 'dest_bits'.
+      return path;
+    }
+
+    // ---------------------
+    // printpath
+    // ---------------------
+    // From input to output.
+    //
+    void printpath(int node) {
+      for (int n : get_path(node)) {
+
+        // If the SigBit has a cell driving it
         //
-        for (auto &conn : cell->connections()) {
+        if (Cell *cell = graph.driver_cell(n)) {
 
-          for (auto bit : sigmap(conn.second)) {
+          log("%5d: %s (via %s)\n", graph.level[n], log_signal(graph.bits[n]),
+              log_id(cell->type));
 
-            if (cell->input(conn.first)) {
-              src_bits.insert(bit);
-            }
+        } else {
 
-            if (cell->output(conn.first)) {
-              dst_bits.insert(bit);
-            }
-          }
+          log("%5d: %s\n", graph.level[n], log_signal(graph.bits[n]));
         }
+      }
+    }
 
-        // If It is a DFF that we know then we consider it as a
-        // cut point in the traversal and we will not add the
-        // src bit to dst bits in the 'bit2bits' forward
-        // traversal table.
-        //
-        if (clk2clk && ff_celltypes.cell_known(cell->type)) {
+    // ---------------------
+    // get_cps
+    // ---------------------
+    // Count the bits on the 'from' chains of the max heigth bits.
+    //
+    void get_cps() {
+      vector<bool> on_cp(graph.nb_nodes(), false);
 
-          for (auto s : src_bits) {
+      nb_cps = 0;
 
-            for (auto d : dst_bits) {
-              bit2ff[s] = tuple<SigBit, Cell *>(d, cell);
-              break;
-            }
-          }
+      for (int n = 0; n < graph.nb_nodes(); n++) {
 
+        if (graph.height[n] != max_heigth) {
           continue;
         }
 
-        // Add the 'src_bits' to the 'dst_bits' relationship
-        // into 'bit2bits' table.
-        //
-        // This table will be used for the traversal in 'runner'
-        // to compute all the 'bit' levels..
-        //
-        for (auto s : src_bits) {
-
-          for (auto d : dst_bits) {
-            bit2bits[s][d] = cell;
-          }
+        for (int b = n; (b >= 0) && (graph.height[b] > 0) && !on_cp[b];
+             b = graph.from[b]) {
+          on_cp[b] = true;
+          nb_cps++;
         }
       }
+    }
 
-      maxlvl = -1;
-      maxbit = State::Sx;
+    // ---------------------
+    // get_driven_bits
+    // ---------------------
+    void get_driven_bits() {
+      nb_driven_bits = 0;
+
+      for (int n = 0; n < graph.nb_nodes(); n++) {
+        if (graph.driver[n] >= 0) {
+          nb_driven_bits++;
+        }
+      }
     }
 
     // ---------------------
-    // get_heigth
+    // report_domains
     // ---------------------
-    int get_heigth(SigBit bit) {
-      auto &bitinfo = bits.at(bit);
+    // Max level and critical path of each clock domain, from the endpoints
+    // captured by its clocked cells. A path crosses domains when its
+    // endpoint fanin cone is launched by another domain.
+    //
+    void report_domains() {
+      // Launching domain of each node : -1 if none, -2 if several.
+      //
+      vector<int> launch(graph.nb_nodes(), -1);
 
-      int heigth = get<3>(bitinfo);
+      for (auto &it : bit2launch) {
 
-      if (heigth >= 0) {
-        return heigth;
-      }
+        int n = graph.node(it.first);
 
-      if (!get<2>(bitinfo)) { // if 'bit' has no cell driving it it is a PI
-        get<3>(bitinfo) = 0;
-        return 0;
+        if (n >= 0) {
+          launch[n] = it.second;
+        }
       }
 
-      if (visited_bits.count(bit) > 0) {
-        get<3>(bitinfo) = 0;
-        log_warning("Detected loop at %s in %s\n", log_signal(bit),
-                    log_id(module));
-        return heigth;
+      for (int n : graph.order) {
+
+        if (launch[n] == -1) {
+          continue;
+        }
+
+        for (int i = graph.fanout_start[n]; i < graph.fanout_start[n + 1];
+             i++) {
+
+          int &fanout_launch = launch[graph.fanout_node[i]];
+
+          if (fanout_launch == -1) {
+            fanout_launch = launch[n];
+          } else if (fanout_launch != launch[n]) {
+            fanout_launch = -2;
+          }
+        }
       }
 
-      visited_bits.insert(bit);
+      int nb_domains = GetSize(clocks);
 
-      heigth = get_heigth(get<1>(bitinfo));
+      vector<int> domain_maxlvl(nb_domains, -1);
+      vector<int> domain_maxnode(nb_domains, -1);
+      vector<int> domain_endpoints(nb_domains, 0);
 
-      heigth += 1;
+      // Cross domain endpoints per (launch, capture) and the deepest one.
+      //
+      dict<pair<int, int>, int> crossings;
+      int nb_crossings = 0;
+      int cross_maxlvl = -1;
+      int cross_maxnode = -1;
 
-      get<3>(bitinfo) = heigth;
+      for (auto &endpoint : endpoints) {
 
-      return heigth;
-    }
+        int n = graph.node(endpoint.first);
+        int domain = endpoint.second;
 
-    // ---------------------
-    // runner
-    // ---------------------
-    void runner(SigBit bit, int level, SigBit from, Cell *via) {
-      auto &bitinfo = bits.at(bit);
+        if (n < 0) {
+          continue;
+        }
 
-      if (get<0>(bitinfo) >= level) {
-        return;
+        int level = graph.level[n];
+
+        domain_endpoints[domain]++;
+
+        if (level > domain_maxlvl[domain]) {
+          domain_maxlvl[domain] = level;
+          domain_maxnode[domain] = n;
+        }
+
+        int from = launch[n];
+
+        if ((from == -1) || (from == domain)) {
+          continue;
+        }
+
+        crossings[{from, domain}]++;
+        nb_crossings++;
+
+        if (level > cross_maxlvl) {
+          cross_maxlvl = level;
+          cross_maxnode = n;
+        }
       }
 
-      // If bit already visited ...
-      //
-      if (visited_bits.count(bit) > 0) {
+      string domain_names;
 
-        log_warning("Detected loop at %s in %s\n", log_signal(bit),
-                    log_id(module));
-        return;
+      log("\n");
+      log("   %-30s %9s %9s\n", "Clock domain", "endpoints", "max level");
+
+      for (int d = 0; d < nb_domains; d++) {
+
+        string name = log_signal(clocks[d]);
+
+        log("   %-30s %9d %9d\n", name.c_str(), domain_endpoints[d],
+            domain_maxlvl[d]);
+
+        design->scratchpad_set_int("max_level.domain." + name + ".max_levels",
+                                   domain_maxlvl[d]);
+
+        domain_names += (d ? " " : "") + name;
       }
 
-      visited_bits.insert(bit);
+      design->scratchpad_set_string("max_level.domains", domain_names);
+      design->scratchpad_set_int("max_level.cross_domain_paths", nb_crossings);
 
-      get<0>(bitinfo) = level;
-      get<1>(bitinfo) = from;
-      get<2>(bitinfo) = via;
+      if (nb_crossings) {
 
-      if (level > maxlvl) {
-        maxlvl = level;
-        maxbit = bit;
+        log("\n");
+        log("   Cross domain paths : %d endpoints\n", nb_crossings);
+
+        for (auto &it : crossings) {
+          log("      %s -> %s : %d\n",
+              (it.first.first == -2) ? "(several)"
+                                     : log_signal(clocks[it.first.first]),
+              log_signal(clocks[it.first.second]), it.second);
+        }
       }
 
-      if (bit2bits.count(bit)) {
+      if (summary) {
+        return;
+      }
 
-        for (auto &it : bit2bits.at(bit)) {
+      for (int d = 0; d < nb_domains; d++) {
 
-          runner(it.first, level + 1, bit, it.second);
+        if (domain_maxlvl[d] < 0) {
+          continue;
         }
+
+        log("\n");
+        log("Max logic level in clock domain %s (length=%d):\n",
+            log_signal(clocks[d]), domain_maxlvl[d]);
+
+        printpath(domain_maxnode[d]);
       }
 
-      visited_bits.erase(bit);
+      if (cross_maxlvl >= 0) {
+
+        log("\n");
+        log("Max logic level of cross domain paths (length=%d):\n",
+            cross_maxlvl);
+
+        printpath(cross_maxnode);
+      }
     }
 
     // ---------------------
-    // printpath
+    // get_endpoints
     // ---------------------
-    // From input to output.
+    // Ends of the paths : driven bits without fanout, module output bits
+    // and, with -clk2clk, the bits captured by clocked cells.
     //
-    void printpath(SigBit bit) {
-      auto &bitinfo = bits.at(bit);
+    vector<int> get_endpoints() {
+      vector<bool> is_endpoint(graph.nb_nodes(), false);
 
-      // If the SigBit 'bit' has a cell driving it
-      //
-      if (get<2>(bitinfo)) {
+      for (int n = 0; n < graph.nb_nodes(); n++) {
 
-        // Print recursively the 'from' bit, e.g the SigBit
-        // on the critical path driving the cell
-        //
-        // Since we first print the driving sigBit, we print
-        // the path from Input to Output.
-        //
-        printpath(get<1>(bitinfo));
+        SigBit bit = graph.bits[n];
+
+        if ((graph.nb_fanins(n) && !graph.nb_fanouts(n)) ||
+            (bit.wire && bit.wire->port_output)) {
+          is_endpoint[n] = true;
+        }
+      }
 
-        Cell *cell = get<2>(bitinfo);
+      for (auto &endpoint : endpoints) {
 
-        log("%5d: %s (via %s)\n", get<0>(bitinfo), log_signal(bit),
-            log_id(cell->type));
+        int n = graph.node(endpoint.first);
 
-      } else {
+        if (n >= 0) {
+          is_endpoint[n] = true;
+        }
+      }
+
+      vector<int> result;
 
-        log("%5d: %s\n", get<0>(bitinfo), log_signal(bit));
+      for (int n = 0; n < graph.nb_nodes(); n++) {
+        if (is_endpoint[n]) {
+          result.push_back(n);
+        }
       }
+
+      return result;
     }
 
     // ---------------------
-    // get_cps_rec
+    // report_endpoints
     // ---------------------
-    void get_cps_rec(SigBit bit, int heigth) {
-      auto &bitinfo = bits.at(bit);
+    // Histogram of the endpoint levels and the 'topk' deepest endpoints with
+    // their critical path. The deepest endpoints are selected with a heap
+    // bounded to 'topk' entries, ties going to the first node.
+    //
+    void report_endpoints() {
+      vector<int> endpoint_nodes = get_endpoints();
+
+      vector<int> histogram(maxlvl + 1, 0);
 
-      // Bit already traversed and TFI added in 'cps'
+      // Min heap on (level, -node) : its top is the endpoint to drop first.
       //
-      if (cps.count(bit)) {
-        return;
+      std::priority_queue<pair<int, int>, vector<pair<int, int>>,
+                          std::greater<pair<int, int>>>
+          heap;
+
+      for (int n : endpoint_nodes) {
+
+        histogram[graph.level[n]]++;
+
+        if (topk <= 0) {
+          continue;
+        }
+
+        heap.push({graph.level[n], -n});
+
+        if (GetSize(heap) > topk) {
+          heap.pop();
+        }
       }
 
-      // return if a PI
-      //
-      if (get<3>(bitinfo) == 0) {
-        return;
+      vector<int> deepest;
+
+      for (; !heap.empty(); heap.pop()) {
+        deepest.push_back(-heap.top().second);
       }
 
-      // If on the CP then add it
-      //
-      if (get<3>(bitinfo) == heigth) {
-        assert(get<2>(bitinfo)); // make sure it is driven
-        cps.insert(bit);
+      std::reverse(deepest.begin(), deepest.end());
+
+      int at_max = (maxlvl >= 0) ? histogram[maxlvl] : 0;
+
+      design->scratchpad_set_int("max_level.endpoints", GetSize(endpoint_nodes));
+      design->scratchpad_set_int("max_level.endpoints_at_max", at_max);
+
+      if (topk > 0) {
+
+        log("\n");
+        log("   Endpoint level histogram (%d endpoints):\n",
+            GetSize(endpoint_nodes));
+
+        for (int lvl = maxlvl; lvl >= 0; lvl--) {
+
+          if (histogram[lvl]) {
+            log("   %5d : %d\n", lvl, histogram[lvl]);
+          }
+        }
+
+        log("\n");
+        log("Top %d deepest endpoints in %s:\n", GetSize(deepest),
+            log_id(module));
+
+        for (int i = 0; i < GetSize(deepest); i++) {
+
+          int n = deepest[i];
+
+          log("\n");
+          log("   #%d %s (length=%d)\n", i + 1, log_signal(graph.bits[n]),
+              graph.level[n]);
+
+          if (!summary) {
+            printpath(n);
+          }
+        }
       }
 
-      // return if not on the CP
-      //
-      if (get<3>(bitinfo) < heigth) {
+      if (json_file.empty()) {
         return;
       }
 
-      visited_bits.insert(bit);
+      json = stringf("    {\"module\": \"%s\", \"max_level\": %d, "
+                     "\"endpoints\": %d,\n",
+                     json_escape(log_id(module)).c_str(), maxlvl,
+                     GetSize(endpoint_nodes));
 
-      SigBit from = get<1>(bitinfo);
+      json += "     \"histogram\": [";
 
-      // Collect 'from' bit with heigth 'heigth-1'
-      //
-      get_cps_rec(from, heigth - 1);
-    }
+      for (int lvl = 0; lvl <= maxlvl; lvl++) {
+        json += stringf("%s%d", lvl ? ", " : "", histogram[lvl]);
+      }
 
-    // ---------------------
-    // get_cps
-    // ---------------------
-    void get_cps() {
-      for (auto &it : bits) {
+      json += "],\n     \"paths\": [";
+
+      for (int i = 0; i < GetSize(deepest); i++) {
+
+        int n = deepest[i];
 
-        if (get<3>(it.second) == max_heigth) {
-          get_cps_rec(it.first, max_heigth);
+        json += stringf("%s\n      {\"endpoint\": \"%s\", \"level\": %d, "
+                        "\"path\": [",
+                        i ? "," : "",
+                        json_escape(log_signal(graph.bits[n])).c_str(),
+                        graph.level[n]);
+
+        vector<int> path = get_path(n);
+
+        for (int j = 0; j < GetSize(path); j++) {
+
+          Cell *cell = graph.driver_cell(path[j]);
+
+          json += stringf(
+              "%s{\"bit\": \"%s\", \"level\": %d, \"cell\": \"%s\", "
+              "\"type\": \"%s\"}",
+              j ? ", " : "",
+              json_escape(log_signal(graph.bits[path[j]])).c_str(),
+              graph.level[path[j]],
+              cell ? json_escape(log_id(cell->name)).c_str() : "",
+              cell ? json_escape(log_id(cell->type)).c_str() : "");
         }
+
+        json += "]}";
       }
+
+      json += "]}";
     }
 
     // ---------------------
-    // get_driven_bits
+    // report_arrivals
     // ---------------------
-    void get_driven_bits() {
-      for (auto &it : bits) {
+    // Arrival times with the -delays cell delays, launched at the clock to Q
+    // delay of the clocked cells, and the endpoint slacks against the
+    // period minus the setup time of the capturing cell.
+    //
+    void report_arrivals() {
+      dict<int, float> launch_times;
 
-        if (get<2>(it.second)) {
-          driven_bits.insert(it.first);
+      for (auto &it : launch_cells) {
+
+        int n = graph.node(it.first);
+        IdString type = it.second->type;
+
+        if ((n >= 0) && delay_model.clk_to_q.count(type)) {
+          launch_times[n] = delay_model.clk_to_q.at(type);
         }
       }
-    }
 
-    // ---------------------
-    // run
-    // ---------------------
-    void run() {
-      visited_bits.clear();
+      graph.compute_arrivals(launch_times);
 
-      for (auto &it : bits) {
+      float max_arrival = 0;
+      int max_node = -1;
 
-        if (get<0>(it.second) < 0) {
+      float worst_slack = 0;
+      int worst_node = -1;
+      float total_negative_slack = 0;
+      int nb_failing = 0;
 
-          runner(it.first, 0, State::Sx, nullptr);
+      for (int n : get_endpoints()) {
+
+        if ((max_node < 0) || (graph.arrival[n] > max_arrival)) {
+          max_arrival = graph.arrival[n];
+          max_node = n;
+        }
+
+        if (delay_model.period <= 0) {
+          continue;
+        }
+
+        float required = delay_model.period;
+
+        auto ff_it = bit2ff.find(graph.bits[n]);
+
+        if (ff_it != bit2ff.end()) {
+
+          IdString type = get<1>(ff_it->second)->type;
+
+          if (delay_model.setup.count(type)) {
+            required -= delay_model.setup.at(type);
+          }
+        }
+
+        float slack = required - graph.arrival[n];
+
+        if ((worst_node < 0) || (slack < worst_slack)) {
+          worst_slack = slack;
+          worst_node = n;
+        }
+
+        if (slack < 0) {
+          total_negative_slack += slack;
+          nb_failing++;
         }
       }
 
-      design->scratchpad_set_int("max_level.max_levels", maxlvl);
+      design->scratchpad_set_string("max_level.max_arrival",
+                                    stringf("%.3f", max_arrival));
 
-      auto startTime = std::chrono::high_resolution_clock::now();
+      log("\n");
+      log("   Max arrival time     = %.3f\n", max_arrival);
 
-      visited_bits.clear();
+      if (delay_model.period > 0) {
 
-      max_heigth = -1;
+        design->scratchpad_set_string("max_level.worst_slack",
+                                      stringf("%.3f", worst_slack));
+        design->scratchpad_set_int("max_level.failing_endpoints", nb_failing);
 
-      for (auto &it : bits) {
+        log("   Period               = %.3f\n", delay_model.period);
+        log("   Worst slack          = %.3f\n", worst_slack);
+        log("   Total negative slack = %.3f\n", total_negative_slack);
+        log("   Failing endpoints    = %d\n", nb_failing);
+      }
 
-        visited_bits.clear();
+      int node = (worst_node >= 0) ? worst_node : max_node;
 
-        if (get<3>(it.second) < 0) {
+      if (summary || (node < 0)) {
+        return;
+      }
 
-          int heigth = get_heigth(it.first);
+      log("\n");
+      log("Critical arrival path in %s (arrival=%.3f):\n", log_id(module),
+          graph.arrival[node]);
 
-          if (heigth > max_heigth) {
-            max_heigth = heigth;
-          }
+      vector<int> path = {node};
+
+      while (graph.arrival_from[path.back()] >= 0) {
+        path.push_back(graph.arrival_from[path.back()]);
+      }
+
+      for (int i = GetSize(path) - 1; i >= 0; i--) {
+
+        int n = path[i];
+
+        if (graph.arrival_driver[n] >= 0) {
+
+          log("%9.3f: %s (via %s)\n", graph.arrival[n],
+              log_signal(graph.bits[n]),
+              log_id(graph.cells[graph.arrival_driver[n]]->type));
+
+        } else {
+
+          log("%9.3f: %s\n", graph.arrival[n], log_signal(graph.bits[n]));
+        }
+      }
+    }
+
+    // ---------------------
+    // run
+    // ---------------------
+    void run() {
+      // First node of max level in node order.
+      //
+      for (int n = 0; n < graph.nb_nodes(); n++) {
+        if (graph.level[n] > maxlvl) {
+          maxlvl = graph.level[n];
+          maxnode = n;
         }
       }
 
+      design->scratchpad_set_int("max_level.max_levels", maxlvl);
+
+      auto startTime = std::chrono::high_resolution_clock::now();
+
+      graph.compute_heights(nb_threads);
+
+      max_heigth = -1;
+
+      for (int n = 0; n < graph.nb_nodes(); n++) {
+        max_heigth = std::max(max_heigth, graph.height[n]);
+      }
+
       get_cps();
       get_driven_bits();
 
@@ -522,8 +799,8 @@ struct MaxLvlPass : public ScriptPass {
         log("\n");
         log("   Max logic level = %d\n", maxlvl);
         log("   Max heigth      = %d\n", max_heigth);
-        log("   CP size         = %ld\n", cps.size());
-        log("   Total bits      = %ld\n", driven_bits.size());
+        log("   CP size         = %d\n", nb_cps);
+        log("   Total bits      = %d\n", nb_driven_bits);
 
       } else {
 
@@ -531,9 +808,11 @@ struct MaxLvlPass : public ScriptPass {
         log("Max logic level in %s (length=%d):\n", log_id(module), maxlvl);
 
         if (maxlvl >= 0) {
-          printpath(maxbit);
+          printpath(maxnode);
         }
 
+        SigBit maxbit = (maxnode >= 0) ? graph.bits[maxnode] : State::Sx;
+
         if (bit2ff.count(maxbit)) {
 
           log("%5s: %s (via %s)\n", "xx", log_signal(get<0>(bit2ff.at(maxbit))),
@@ -543,8 +822,20 @@ struct MaxLvlPass : public ScriptPass {
         log("\n");
         log("   Max logic level = %d\n", maxlvl);
         log("   Max heigth      = %d\n", max_heigth);
-        log("   CP size         = %ld\n", cps.size());
-        log("   Total bits      = %ld\n", driven_bits.size());
+        log("   CP size         = %d\n", nb_cps);
+        log("   Total bits      = %d\n", nb_driven_bits);
+      }
+
+      if ((topk > 0) || !json_file.empty()) {
+        report_endpoints();
+      }
+
+      if (use_delays) {
+        report_arrivals();
+      }
+
+      if (clk2clk) {
+        report_domains();
       }
     }
   };
@@ -580,11 +871,55 @@ struct MaxLvlPass : public ScriptPass {
     log("        considered as cut points. This is off by default. All cells "
         "are \n");
     log("        traversable by default even DFFs, RAMs, ....\n");
+    log("        With -clk2clk, the max level and the critical path of each "
+        "clock\n");
+    log("        domain are reported too, as well as the paths whose "
+        "endpoint is\n");
+    log("        launched by another clock domain.\n");
     log("\n");
 
     log("    -summary\n");
     log("        just print max level number.\n");
     log("\n");
+    log("    -topk <N>\n");
+    log("        Print the histogram of the endpoint levels and the critical "
+        "paths\n");
+    log("        of the N deepest endpoints.\n");
+    log("\n");
+    log("    -json <file>\n");
+    log("        Dump the endpoint level histogram and the -topk paths of each "
+        "module\n");
+    log("        in JSON format.\n");
+    log("\n");
+    log("    -delays <file>\n");
+    log("        Read the cell delays of the 'timing' section of a config "
+        "file and\n");
+    log("        report the arrival times and, with a period, the endpoint "
+        "slacks.\n");
+    log("        Clocked cells launch at their 'clk_to_q' delay and capture "
+        "at the\n");
+    log("        period minus their 'setup' time.\n");
+    log("\n");
+    log("    -period <value>\n");
+    log("        Clock period of the slacks, overrides the 'timing' section "
+        "one.\n");
+    log("\n");
+    log("    -incremental\n");
+    log("        The graph of each module is kept attached to the design and "
+        "reused\n");
+    log("        while the module does not change. With this option, a "
+        "changed module\n");
+    log("        only updates the cells changed since the previous call, and "
+        "the levels\n");
+    log("        of their fanout cones, instead of rebuilding the graph.\n");
+    log("\n");
+    log("    -threads <N>\n");
+    log("        Levelize the nodes of each topological level with N threads "
+        "(0 for\n");
+    log("        all the cores). Results are the same as with one thread, "
+        "which is\n");
+    log("        the default.\n");
+    log("\n");
   }
 
   // ---------------------
@@ -593,6 +928,12 @@ struct MaxLvlPass : public ScriptPass {
   void clear_flags() override {
     clk2clk = false;
     summary = false;
+    nb_threads = 1;
+    topk = 0;
+    json_file = "";
+    incremental = false;
+    use_delays = false;
+    delay_model = DelayModel();
   }
 
   // ---------------------
@@ -605,6 +946,9 @@ struct MaxLvlPass : public ScriptPass {
                "Executing 'max_level' command (find max logic level).\n");
     clear_flags();
 
+    string delays_file;
+    float period = 0;
+
     size_t argidx;
 
     G_design = design;
@@ -619,20 +963,153 @@ struct MaxLvlPass : public ScriptPass {
         summary = true;
         continue;
       }
+      if (args[argidx] == "-topk" && argidx + 1 < args.size()) {
+        topk = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-json" && argidx + 1 < args.size()) {
+        json_file = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-incremental") {
+        incremental = true;
+        continue;
+      }
+      if (args[argidx] == "-delays" && argidx + 1 < args.size()) {
+        delays_file = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-period" && argidx + 1 < args.size()) {
+        period = atof(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-threads" && argidx + 1 < args.size()) {
+        nb_threads = get_nb_threads(args[++argidx]);
+        continue;
+      }
       break;
     }
 
     extra_args(args, argidx, design);
 
+    if (!delays_file.empty()) {
+
+      read_delays(delays_file);
+      use_delays = true;
+
+      // The delays are captured by the graph edges : the shared graphs are
+      // not used.
+      //
+      if (incremental) {
+        log_warning("-incremental is ignored with -delays.\n");
+        incremental = false;
+      }
+    }
+
+    if (period > 0) {
+      delay_model.period = period;
+    }
+
     run_script(design, run_from, run_to);
   }
 
+  // ---------------------
+  // read_delays
+  // ---------------------
+  // Fill 'delay_model' from the 'timing' section of 'file'.
+  //
+  void read_delays(string file) {
+    std::ifstream f(file);
+
+    if (!f.is_open()) {
+      log_cmd_error("Cannot open delays file '%s'.\n", file.c_str());
+    }
+
+    int line = 1;
+    JsonNode root(f, file, line);
+
+    if ((root.type != 'D') || !root.data_dict.count("timing")) {
+      log_error("No 'timing' section in '%s'.\n", file.c_str());
+    }
+
+    JsonNode *timing = root.data_dict.at("timing");
+
+    if (timing->type != 'D') {
+      log_error("'timing' must be a dictionnary.\n");
+    }
+
+    if (timing->data_dict.count("period")) {
+      delay_model.period = json_number(timing->data_dict.at("period"));
+    }
+
+    if (timing->data_dict.count("default")) {
+      delay_model.default_delay = json_number(timing->data_dict.at("default"));
+    }
+
+    if (!timing->data_dict.count("cells")) {
+      return;
+    }
+
+    JsonNode *cells = timing->data_dict.at("cells");
+
+    if (cells->type != 'D') {
+      log_error("'cells' from 'timing' must be a dictionnary.\n");
+    }
+
+    for (auto &it : cells->data_dict) {
+
+      IdString type = RTLIL::escape_id(it.first);
+      JsonNode *delays = it.second;
+
+      if (delays->type != 'D') {
+        delay_model.cell_delay[type] = json_number(delays);
+        continue;
+      }
+
+      for (auto &arc : delays->data_dict) {
+
+        float delay = json_number(arc.second);
+
+        if (arc.first == "default") {
+          delay_model.cell_delay[type] = delay;
+          continue;
+        }
+        if (arc.first == "clk_to_q") {
+          delay_model.clk_to_q[type] = delay;
+          continue;
+        }
+        if (arc.first == "setup") {
+          delay_model.setup[type] = delay;
+          continue;
+        }
+
+        size_t pos = arc.first.find("->");
+
+        if (pos == string::npos) {
+          log_error("Unknown delay '%s' of cell '%s' in '%s'.\n",
+                    arc.first.c_str(), it.first.c_str(), file.c_str());
+        }
+
+        IdString from = RTLIL::escape_id(arc.first.substr(0, pos));
+        IdString to = RTLIL::escape_id(arc.first.substr(pos + 2));
+
+        delay_model.arc_delay[tuple<IdString, IdString, IdString>(type, from,
+                                                                  to)] = delay;
+      }
+    }
+
+    log("Read %d cell delays from '%s'.\n", GetSize(cells->data_dict),
+        file.c_str());
+  }
+
   // ---------------------
   // script
   // ---------------------
   void script() override {
     load_LUT_models();
 
+    vector<string> modules_json;
+
     for (Module *module : G_design->selected_modules()) {
       if (module->has_processes_warn()) {
         continue;
@@ -640,7 +1117,38 @@ struct MaxLvlPass : public ScriptPass {
 
       MaxLvlWorker worker(module);
       worker.run();
+
+      if (!worker.json.empty()) {
+        modules_json.push_back(worker.json);
+      }
+    }
+
+    if (!json_file.empty()) {
+      dump_json(modules_json);
+    }
+  }
+
+  // ---------------------
+  // dump_json
+  // ---------------------
+  void dump_json(const vector<string> &modules_json) {
+    std::ofstream json(json_file);
+
+    if (!json.is_open()) {
+      log_warning("Cannot open JSON file '%s'.\n", json_file.c_str());
+      return;
+    }
+
+    json << "{\"max_level\": [\n";
+
+    for (int i = 0; i < GetSize(modules_json); i++) {
+      json << modules_json[i] << ((i + 1 < GetSize(modules_json)) ? ",\n" : "\n");
     }
+
+    json << "]}\n";
+    json.close();
+
+    log("\n   Dumped JSON file %s\n", json_file.c_str());
   }
 
 } MaxLvlPass;
@@ -20,159 +20,128 @@
 #include "kernel/celltypes.h"
 #include "kernel/sigtools.h"
 #include "kernel/yosys.h"
+#include "cell_library.h"
+#include "timing_graph.h"
 #include <cassert>
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <map>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
 static bool dot = false;
+static int nb_threads = 1;
+static bool incremental = false;
+static bool slack_attr = false;
+static string cp_file;
+static int max_nodes = 200;
 
 struct MaxHeigthWorker {
   RTLIL::Design *design;
   RTLIL::Module *module;
-  SigMap sigmap;
 
-  // Bit info attached to a SigBit:
-  //    - level
-  //    - sigBit
-  //    - driven cell from the sigbit
-  //    - height
+  // Bit graph over the LUT cells, and the SigMap it is built with, shared
+  // through the design 'TimingMonitor' cache. Constant LUT inputs are
+  // sources of height 0.
   //
-  dict<SigBit, tuple<pool<SigBit> *, Cell *, int>> bits;
+  SigMap &sigmap;
+  TimingGraph &graph;
 
-#define INPUTS(x) get<0>(x)
-#define CELL(x) get<1>(x)
-#define HEIGTH(x) get<2>(x)
+  vector<bool> on_cp;
+  int nb_cps = 0;
 
-  pool<SigBit> visited_bits;
+  int nb_luts = 0;
 
-  pool<SigBit> cps;
-  pool<SigBit> luts;
-  dict<SigBit, int> fanout;
+  // LUT cell -> min slack of its output bits, and the number of LUT cells
+  // with no slack.
+  //
+  dict<Cell *, int> cell_slack;
+  int nb_zero_slacks = 0;
 
   // ---------------------
   // MaxHeigthWorker
   // ---------------------
   //
   MaxHeigthWorker(RTLIL::Module *module)
-      : design(module->design), module(module), sigmap(module) {
-
-    for (auto wire : module->selected_wires()) {
-
-      for (auto bit : sigmap(wire)) {
+      : design(module->design), module(module),
+        sigmap(TimingMonitor::get(module->design)->sigmap(module)),
+        graph(TimingMonitor::get(module->design)->graph(module, "max_height")) {
 
-        bits[bit] = tuple<pool<SigBit> *, Cell *, int>(nullptr, nullptr, -1);
+    auto traversable = [&](Cell *cell) {
+      if (!CellLibrary::get().is_lut_logic(cell->type)) {
+        return false;
       }
-    }
-
-    for (auto cell : module->selected_cells()) {
-
-      if ((cell->type != "$lut") &&
-
-          // Handle Ice40 cells
-          //
-          (cell->type != "\\SB_LUT4") && (cell->type != "\\SB_CARRY") &&
-
-          // Handle also Xilinx lut cells
-          //
-          (cell->type != "\\IBUF") && (cell->type != "\\OBUF") &&
-          (cell->type != "\\MUXCY") && (cell->type != "\\XORCY") &&
-          (cell->type != "\\MUXF5") && (cell->type != "\\MUXF6") &&
-          (cell->type != "\\MUXF7") && (cell->type != "\\MUXF8") &&
-          (cell->type != "\\LUT1") && (cell->type != "\\LUT2") &&
-          (cell->type != "\\LUT3") && (cell->type != "\\LUT4") &&
-          (cell->type != "\\LUT5") && (cell->type != "\\LUT6")) {
-
-        continue;
-      }
-
-      SigBit out;
-      bool out_exists = false;
-
-      pool<SigBit> *inputs = new pool<SigBit>;
 
       for (auto &conn : cell->connections()) {
-
-        for (auto bit : sigmap(conn.second)) {
-
-          if (cell->input(conn.first)) {
-            inputs->insert(bit);
-            continue;
-          }
-
-          if (cell->output(conn.first)) {
-            out = bit;
-            out_exists = true;
-          }
+        if (cell->output(conn.first) && !conn.second.empty()) {
+          return true;
         }
       }
 
-      if (!out_exists) {
-        log_warning("It seems Lut cell '%s' is undriven.\n",
-                    log_id(cell->name));
-        continue;
-      }
+      log_warning("It seems Lut cell '%s' is undriven.\n", log_id(cell->name));
 
-      luts.insert(out);
+      return false;
+    };
 
-      auto &bitinfo = bits.at(out);
+    TimingMonitor::get(design)->levelize(module, "max_height", traversable,
+                                         true, nb_threads, incremental);
 
-      INPUTS(bitinfo) = inputs;
-      CELL(bitinfo) = cell;
+    // LUT output bits
+    //
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+      if (graph.nb_fanins(n)) {
+        nb_luts++;
+      }
     }
+
+    on_cp.assign(graph.nb_nodes(), false);
   }
 
   // ---------------------
   // get_cp_logic_rec
   // ---------------------
-  void get_cp_logic_rec(SigBit bit, int height) {
-    if (bits.count(bit) == 0) { // constant case
+  void get_cp_logic_rec(int n, int height) {
+    if (graph.is_const[n]) { // constant case
       return;
     }
 
-    auto &bitinfo = bits.at(bit);
-
-    // Bit already in 'cps' so already traversed and TFI already added in 'cps'
+    // Bit already in CP so already traversed and TFI already added in CP
     //
-    if (cps.count(bit)) {
+    if (on_cp[n]) {
       return;
     }
 
     // return if a PI
     //
-    if (HEIGTH(bitinfo) == 0) {
+    if (graph.height[n] == 0) {
       return;
     }
 
-    // If on the CP then add it
-    //
-    if (HEIGTH(bitinfo) == height) {
-      assert(CELL(bitinfo)); // make sure it is driven
-      cps.insert(bit);
-    }
-
     // return if not on the CP
     //
-    if (HEIGTH(bitinfo) < height) {
+    if (graph.height[n] < height) {
       return;
     }
 
-    if (HEIGTH(bitinfo) > height) {
+    if (graph.height[n] > height) {
       log_error("Problem in the CP extractor : Height %d must be less than "
                 "height %d\n",
-                HEIGTH(bitinfo), height);
+                graph.height[n], height);
     }
 
-    pool<SigBit> *inputs = INPUTS(bitinfo);
+    // On the CP then add it
+    //
+    assert(graph.nb_fanins(n)); // make sure it is driven
+    on_cp[n] = true;
+    nb_cps++;
 
-    for (auto from : *inputs) {
+    for (int i = graph.fanin_start[n]; i < graph.fanin_start[n + 1]; i++) {
 
       // Collect recursivelet from the TFI from 'from' with height 'height-1'
       //
-      get_cp_logic_rec(from, height - 1);
+      get_cp_logic_rec(graph.fanin_node[i], height - 1);
     }
   }
 
@@ -180,12 +149,53 @@ struct MaxHeigthWorker {
   // get_cp_logic
   // ---------------------
   void get_cp_logic(int max_height) {
-    // Extract CP from the 'bits' starting with 'max_height'.
+    // Extract CP from the nodes starting with 'max_height'.
     //
-    for (auto &it : bits) {
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+
+      if (graph.height[n] == max_height) {
+        get_cp_logic_rec(n, max_height);
+      }
+    }
+  }
+
+  // ---------------------
+  // get_slacks
+  // ---------------------
+  // Slack of each LUT output bit relative to 'max_height', the slack of a
+  // LUT cell being the min slack of its output bits. LUT cells with some
+  // slack are off the critical cone and can be remapped for area as long
+  // as their height stays within their required height.
+  //
+  void get_slacks(int max_height) {
+    graph.compute_required(max_height);
+
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+
+      if (!graph.nb_fanins(n)) {
+        continue;
+      }
 
-      if (HEIGTH(it.second) == max_height) {
-        get_cp_logic_rec(it.first, max_height);
+      Cell *cell = graph.cells[graph.fanin_cell[graph.fanin_start[n]]];
+      int slack = graph.required[n] - graph.height[n];
+
+      auto it = cell_slack.find(cell);
+
+      if (it == cell_slack.end()) {
+        cell_slack[cell] = slack;
+      } else {
+        it->second = std::min(it->second, slack);
+      }
+    }
+
+    for (auto &it : cell_slack) {
+
+      if (it.second == 0) {
+        nb_zero_slacks++;
+      }
+
+      if (slack_attr) {
+        it.first->attributes[ID(max_height_slack)] = it.second;
       }
     }
   }
@@ -205,49 +215,41 @@ struct MaxHeigthWorker {
   // ---------------------
   // print_one_cp_logic_rec
   // ---------------------
-  int print_one_cp_logic_rec(SigBit bit, int height) {
+  int print_one_cp_logic_rec(int n, int height) {
 
-    if (bits.count(bit) == 0) { // constant case
-      string name = bit_name(bit);
+    if (graph.is_const[n]) { // constant case
+      string name = bit_name(graph.bits[n]);
       log("  CONSTANT : %s\n", name.c_str()); 
       return 1;
     }
 
-    auto &bitinfo = bits.at(bit);
-
     // return if not on the CP
     //
-    if (HEIGTH(bitinfo) < height) {
+    if (graph.height[n] < height) {
       return 0;
     }
 
-    if (HEIGTH(bitinfo) > height) {
+    if (graph.height[n] > height) {
       log_error("Problem in the print CP function : Height %d must be less than "
                 "height %d\n",
-                HEIGTH(bitinfo), height);
+                graph.height[n], height);
     }
 
-    // we are traveling along a CP
-    //
-    assert(HEIGTH(bitinfo) == height);
-
     // Terminal Case of a PI
     //
-    if (HEIGTH(bitinfo) == 0) {
-      string name = bit_name(bit);
+    if (height == 0) {
+      string name = bit_name(graph.bits[n]);
       log("        %s\n", name.c_str());
       return 1;
     }
 
-    pool<SigBit> *inputs = INPUTS(bitinfo);
-
     int found_cp = 0;
 
-    for (auto from : *inputs) {
+    for (int i = graph.fanin_start[n]; i < graph.fanin_start[n + 1]; i++) {
 
       // Print recursively the first successfull sub CP 
       //
-      if (print_one_cp_logic_rec(from, height - 1)) {
+      if (print_one_cp_logic_rec(graph.fanin_node[i], height - 1)) {
         found_cp = 1;
         break;
       }
@@ -259,14 +261,13 @@ struct MaxHeigthWorker {
 
     // It is a cell
     //
-    assert(CELL(bitinfo)); // make sure it is driven
-                           //
-    Cell *cell = CELL(bitinfo);
+    Cell *cell = graph.driver_cell(n);
+    assert(cell); // make sure it is driven
 
     string cell_name = log_id(cell->name);
     string cell_type = log_id(cell->type);
 
-    log(" %3d:   %s (%s)\n", HEIGTH(bitinfo), cell_name.c_str(), cell_type.c_str());
+    log(" %3d:   %s (%s)\n", height, cell_name.c_str(), cell_type.c_str());
 
     return 1;
   }
@@ -280,207 +281,168 @@ struct MaxHeigthWorker {
     log("Printing one critical path \n");
     log("--------------------------\n");
 
-    // Print one CP from the 'bits' starting with 'max_height'.
+    // Print one CP from the nodes starting with 'max_height'.
     //
-    for (auto &it : bits) {
-
-      if (HEIGTH(it.second) == max_height) {
+    for (int n = 0; n < graph.nb_nodes(); n++) {
 
-        if (print_one_cp_logic_rec(it.first, max_height)) {
+      if (graph.height[n] == max_height) {
 
-          auto &bitinfo = bits.at(it.first);
+        if (print_one_cp_logic_rec(n, max_height)) {
 
-	  string name = bit_name(it.first);
+          string name = bit_name(graph.bits[n]);
 
           log("        %s\n", name.c_str());
 
           return;
-	}
-      }
-    }
-  }
-
-  // ---------------------
-  // legalize_dot_name
-  // ---------------------
-  void legalize_dot_name(string &s) {
-    for (long unsigned int i = 0; i < s.size(); i++) {
-
-      if (s[i] == '$') {
-        s[i] = '_';
-        continue;
-      }
-      if (s[i] == '\\') {
-        s[i] = '_';
-        continue;
-      }
-      if (s[i] == '[') {
-        s[i] = '_';
-        continue;
-      }
-      if (s[i] == ']') {
-        s[i] = '_';
-        continue;
-      }
-      if (s[i] == '.') {
-        s[i] = '_';
-        continue;
-      }
-      if (s[i] == ':') {
-        s[i] = '_';
-        continue;
+        }
       }
     }
   }
 
   // ---------------------
-  // dot_cell
+  // dump_cp
   // ---------------------
-  void dot_cell(std::ofstream &cells_dot, Cell *cell) {
-    for (auto &conn : cell->connections()) {
-
-      string cell_name = log_id(cell->name);
-      legalize_dot_name(cell_name);
+  // Write the CP logic of height 'max_height' in 'file', in JSON if its name ends with '.json' and
+  // in DOT otherwise. Vertices are the CP bits labeled with their driver
+  // LUT. Only the 'max_nodes' highest bits are written, the others are
+  // merged in one super node per height. Lines are written as they are
+  // generated.
+  //
+  void dump_cp(const string &file, int max_height) {
+    bool json =
+        (GetSize(file) > 5) && (file.substr(GetSize(file) - 5) == ".json");
 
-      for (auto bit : sigmap(conn.second)) {
+    std::ofstream out(file);
 
-        string name = log_signal(bit);
-        legalize_dot_name(name);
+    if (!out.is_open()) {
+      log_warning("Cannot open file '%s' to dump the CP logic.\n",
+                  file.c_str());
+      return;
+    }
 
-        if (cell->input(conn.first)) {
-          cells_dot << cell_name << " -> " << name << "\n";
-          continue;
-        }
+    // CP bits, highest first. The vertex of a kept bit is its index, the
+    // one of a merged bit is the super node of its height (-1 - height).
+    //
+    vector<int> cp_nodes;
 
-        if (cell->output(conn.first)) {
-          cells_dot << name << " -> " << cell_name << "\n";
-          continue;
-        }
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+      if (on_cp[n]) {
+        cp_nodes.push_back(n);
       }
     }
-  }
-
-  // ---------------------
-  // dump_cp_dot
-  // ---------------------
-  void dump_cp_dot() {
-    std::ofstream cells_dot;
-
-    cells_dot.open("cp.dot");
 
-    cells_dot << "digraph cp {\n";
-
-    // Dump definition and collect Cells in CP
-    //
-    pool<Cell *> cells;
+    std::stable_sort(cp_nodes.begin(), cp_nodes.end(), [&](int a, int b) {
+      return graph.height[a] > graph.height[b];
+    });
 
-    for (auto bit : cps) {
+    vector<int> vertex(graph.nb_nodes(), 0);
+    std::map<int, int> super_size;
+    int nb_kept = 0;
 
-      auto &bitinfo = bits.at(bit);
+    for (int i = 0; i < GetSize(cp_nodes); i++) {
+      int n = cp_nodes[i];
 
-      Cell *cell = CELL(bitinfo);
-      int height = HEIGTH(bitinfo);
-      pool<SigBit> *inputs = INPUTS(bitinfo);
-
-      cells.insert(cell);
+      if ((max_nodes <= 0) || (i < max_nodes)) {
+        vertex[n] = i;
+        nb_kept++;
+        continue;
+      }
 
-      string cell_name = log_id(cell->name);
-      legalize_dot_name(cell_name);
-      int fo = fanout[bit];
-      long unsigned int nb = inputs->size();
-      cells_dot << cell_name << " [shape=box, label=\"" << cell_name << "\nLUT"
-                << nb << "\nheight=" << height << "\nfo=" << fo << "\"]\n";
+      vertex[n] = -1 - graph.height[n];
+      super_size[graph.height[n]]++;
     }
 
-    // Dump definition and Collect cells periphery bits
-    //
-    pool<SigBit> cp_bits;
-
-    for (auto cell : cells) {
+    auto vertex_id = [&](int v) {
+      return (v >= 0) ? stringf("n%d", v) : stringf("h%d", -1 - v);
+    };
 
-      for (auto &conn : cell->connections()) {
-
-        for (auto bit : sigmap(conn.second)) {
+    if (json) {
+      out << "{\n";
+      out << "  \"module\": \"" << json_escape(log_id(module)) << "\",\n";
+      out << "  \"max_height\": " << max_height << ",\n";
+      out << "  \"nodes\": [";
+    } else {
+      out << "digraph cp {\n";
+    }
 
-          cp_bits.insert(bit);
+    const char *sep = "\n";
 
-          string name = log_signal(bit);
-          legalize_dot_name(name);
+    for (int i = 0; i < nb_kept; i++) {
+      int n = cp_nodes[i];
 
-          auto &bitinfo = bits.at(bit);
-          int height = HEIGTH(bitinfo);
+      Cell *cell = graph.driver_cell(n);
+      string cell_name = json_escape(log_id(cell->name));
+      string cell_type = json_escape(log_id(cell->type));
+      string bit = json_escape(bit_name(graph.bits[n]));
 
-          if (cps.count(bit)) {
-            cells_dot << name << " [color=\"red\" style=filled label=\"" << name
-                      << "\nheight=" << height << "\"]\n";
-          } else {
-            cells_dot << name << " [color=\"green\" style=filled label=\""
-                      << name << "\nheight=" << height << "\"]\n";
-          }
-        }
+      if (json) {
+        out << sep << "    {\"id\": \"n" << i << "\", \"cell\": \"" << cell_name
+            << "\", \"type\": \"" << cell_type << "\", \"bit\": \"" << bit
+            << "\", \"height\": " << graph.height[n]
+            << ", \"fanout\": " << graph.nb_fanouts(n) << "}";
+        sep = ",\n";
+        continue;
       }
-    }
 
-    for (auto cell : cells) {
-      dot_cell(cells_dot, cell);
+      out << "n" << i << " [shape=box, label=\"" << cell_name << "\\n"
+          << cell_type << "\\n" << bit << "\\nheight=" << graph.height[n]
+          << "\\nfo=" << graph.nb_fanouts(n) << "\"]\n";
     }
 
-    cells_dot << "}\n";
-    cells_dot.close();
+    for (auto &it : super_size) {
 
-    log("\nDumped 'cp.dot' file. Use 'xdot' to view it\n");
-    system("xdot cp.dot");
-  }
+      if (json) {
+        out << sep << "    {\"id\": \"h" << it.first
+            << "\", \"bits\": " << it.second
+            << ", \"height\": " << it.first << "}";
+        sep = ",\n";
+        continue;
+      }
 
-  // ---------------------
-  // get_height_rec
-  // ---------------------
-  int get_height_rec(SigBit bit) {
-    if (bits.count(bit) == 0) { // constant case
-      return 0;
+      out << "h" << it.first << " [shape=box3d, color=\"grey\", label=\""
+          << it.second << " bits\\nheight=" << it.first << "\"]\n";
     }
 
-    auto &bitinfo = bits.at(bit);
-
-    fanout[bit] += 1;
-
-    int height = HEIGTH(bitinfo);
-
-    if (height >= 0) {
-      return height;
+    if (json) {
+      out << "\n  ],\n  \"edges\": [";
+      sep = "\n";
     }
 
-    if (!CELL(bitinfo)) { // if 'bit' has no cell driving it it is a PI or
-                          // undriven wire
-      HEIGTH(bitinfo) = 0;
-      return 0;
-    }
+    // Edges between the vertices of a CP bit and its CP fanins, once each.
+    //
+    pool<std::pair<int, int>> edges;
 
-    if (visited_bits.count(bit) > 0) {
-      HEIGTH(bitinfo) = 0;
-      log_warning("Detected loop at %s in %s\n", log_signal(bit),
-                  log_id(module));
-      return 0;
-    }
+    for (int n : cp_nodes) {
 
-    visited_bits.insert(bit);
+      for (int i = graph.fanin_start[n]; i < graph.fanin_start[n + 1]; i++) {
 
-    pool<SigBit> *inputs = INPUTS(bitinfo);
+        int fanin = graph.fanin_node[i];
 
-    int max_height = -1;
+        if (!on_cp[fanin]) {
+          continue;
+        }
 
-    for (auto in : *inputs) {
+        if (!edges.insert({vertex[fanin], vertex[n]}).second) {
+          continue;
+        }
 
-      int in_height = get_height_rec(in);
+        if (json) {
+          out << sep << "    [\"" << vertex_id(vertex[fanin]) << "\", \""
+              << vertex_id(vertex[n]) << "\"]";
+          sep = ",\n";
+          continue;
+        }
 
-      if (in_height > max_height) {
-        max_height = in_height;
+        out << vertex_id(vertex[fanin]) << " -> " << vertex_id(vertex[n])
+            << "\n";
       }
     }
 
-    HEIGTH(bitinfo) = max_height + 1;
+    out << (json ? "\n  ]\n}\n" : "}\n");
+    out.close();
 
-    return max_height + 1;
+    log("\nDumped the CP logic in '%s' : %d of %d bits, %d super nodes.\n",
+        file.c_str(), nb_kept, GetSize(cp_nodes), GetSize(super_size));
   }
 
   // ---------------------
@@ -489,22 +451,10 @@ struct MaxHeigthWorker {
   int get_max_height() {
     int max_height = -1;
 
-    for (auto &it : bits) {
-      fanout[it.first] = 0;
-    }
-
-    for (auto &it : bits) {
-
-      if (HEIGTH(it.second) < 0) { // if Heigth not computed yet
-
-        visited_bits.clear();
+    graph.compute_heights(nb_threads);
 
-        int height = get_height_rec(it.first);
-
-        if (height > max_height) {
-          max_height = height;
-        }
-      }
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+      max_height = std::max(max_height, graph.height[n]);
     }
 
     return max_height;
@@ -522,23 +472,34 @@ struct MaxHeigthWorker {
 
     design->scratchpad_set_int("max_height.max_height", max_height);
 
+    // get the slack of each LUT cell relative to 'max_height'
+    //
+    get_slacks(max_height);
+
+    design->scratchpad_set_int("max_height.zero_slack_luts", nb_zero_slacks);
+    design->scratchpad_set_int("max_height.slack_luts",
+                               GetSize(cell_slack) - nb_zero_slacks);
+
     // get the logic on the critical paths starting with height 'max_height'
     //
     get_cp_logic(max_height);
 
     print_one_cp_logic(max_height);
 
-    // Eventually dump the dot file fo the CP logic
-    // NOTE: we can use 'xdot' to view the dot file
+    // Eventually dump the CP logic
+    // NOTE: we can use 'xdot' to view a dot file
     //
-    if (dot) {
-      dump_cp_dot();
+    if (!cp_file.empty()) {
+      dump_cp(cp_file, max_height);
     }
 
     log("\n");
     log("   Max height / Max levels    = %d\n", max_height);
-    log("   CP bits size               = %ld\n", cps.size());
-    log("   Total lut output bits      = %ld\n", luts.size());
+    log("   CP bits size               = %d\n", nb_cps);
+    log("   Total lut output bits      = %d\n", nb_luts);
+    log("   Zero slack lut cells       = %d\n", nb_zero_slacks);
+    log("   Lut cells with slack       = %d\n",
+        GetSize(cell_slack) - nb_zero_slacks);
 
     auto endTime = std::chrono::high_resolution_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
@@ -571,14 +532,62 @@ struct MaxHeigthPass : public ScriptPass {
     log("overall longest path in the design.\n");
     log("\n");
     log("    -dot\n");
-    log("        Dump a 'dot' file representing only the critical logic.\n");
+    log("        Dump a 'cp.dot' file representing only the critical logic. "
+        "No viewer\n");
+    log("        is launched, use 'xdot cp.dot' to view it.\n");
+    log("\n");
+    log("    -cp_file <file>\n");
+    log("        Dump the critical logic in 'file', in JSON if its name ends "
+        "with\n");
+    log("        '.json' and in DOT otherwise.\n");
+    log("\n");
+    log("    -max_nodes <N>\n");
+    log("        Only dump the N highest critical bits, the others are merged "
+        "in one\n");
+    log("        super node per height. Default is 200, 0 dumps all the "
+        "bits.\n");
+    log("\n");
+    log("    -incremental\n");
+    log("        The graph of each module is kept attached to the design and "
+        "reused\n");
+    log("        while the module does not change. With this option, a "
+        "changed module\n");
+    log("        only updates the cells changed since the previous call, and "
+        "the levels\n");
+    log("        of their fanout cones, instead of rebuilding the graph.\n");
+    log("\n");
+    log("    -slack\n");
+    log("        Annotate each LUT cell with its slack relative to the max "
+        "height, in\n");
+    log("        attribute 'max_height_slack'. The slack of a LUT cell is the "
+        "number of\n");
+    log("        levels its height can grow by without increasing the max "
+        "height. The\n");
+    log("        counts of LUT cells with and without slack are always "
+        "stored in the\n");
+    log("        scratchpad ('max_height.slack_luts', "
+        "'max_height.zero_slack_luts').\n");
+    log("\n");
+    log("    -threads <N>\n");
+    log("        Levelize the nodes of each topological level with N threads "
+        "(0 for\n");
+    log("        all the cores). Results are the same as with one thread, "
+        "which is\n");
+    log("        the default.\n");
     log("\n");
   }
 
   // ---------------------
   // clear_flags
   // ---------------------
-  void clear_flags() override { dot = false; }
+  void clear_flags() override {
+    dot = false;
+    nb_threads = 1;
+    incremental = false;
+    slack_attr = false;
+    cp_file = "";
+    max_nodes = 200;
+  }
 
   // ---------------------
   // execute
@@ -598,6 +607,27 @@ struct MaxHeigthPass : public ScriptPass {
     for (argidx = 1; argidx < args.size(); argidx++) {
       if (args[argidx] == "-dot") {
         dot = true;
+        cp_file = "cp.dot";
+        continue;
+      }
+      if (args[argidx] == "-cp_file" && argidx + 1 < args.size()) {
+        cp_file = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-max_nodes" && argidx + 1 < args.size()) {
+        max_nodes = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-incremental") {
+        incremental = true;
+        continue;
+      }
+      if (args[argidx] == "-slack") {
+        slack_attr = true;
+        continue;
+      }
+      if (args[argidx] == "-threads" && argidx + 1 < args.size()) {
+        nb_threads = get_nb_threads(args[++argidx]);
         continue;
       }
     }
@@ -622,6 +652,10 @@ struct MaxHeigthPass : public ScriptPass {
       return;
     }
 
+    // The Verilog dumps need split nets : they are written from a copy so
+    // that the heights are computed on the design itself, keeping its '-slack'
+    // annotations and its cached timing graph.
+    //
     if (dot) {
 
       run("design -push-copy");
@@ -632,6 +666,8 @@ struct MaxHeigthPass : public ScriptPass {
                   "dot_cells.vlg"));
       run(stringf(
           "write_verilog -nohex -nodec -norename -simple-lhs dot_expr.vlg"));
+
+      run("design -pop");
     }
 
     // Usefull to extract Xilinx levels
@@ -646,10 +682,6 @@ struct MaxHeigthPass : public ScriptPass {
       MaxHeigthWorker worker(module);
       worker.run();
     }
-
-    if (dot) {
-      run("design -pop");
-    }
   }
 
 } MaxHeigthPass;
@@ -0,0 +1,286 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+//
+#include "kernel/yosys.h"
+#include <chrono>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct CpResynthPass : public ScriptPass {
+
+  RTLIL::Design *G_design = NULL;
+
+  string lut_size;
+  string abc_script;
+  int margin;
+  int depth;
+  int max_iter;
+
+  CpResynthPass()
+      : ScriptPass("cp_resynth", "re-synthesize the critical LUT cone") {}
+
+  // ---------------------
+  // help
+  // ---------------------
+  void help() override {
+    //   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+    log("\n");
+    log("    cp_resynth [options]\n");
+    log("\n");
+    log("This command re-runs ABC with a delay script on the critical cone "
+        "only : the\n");
+    log("LUT cells whose slack relative to the max height is within the "
+        "margin (see\n");
+    log("'max_height -slack'). The cone is extracted in a sub module, "
+        "converted back to\n");
+    log("gates and re-mapped. The result is kept only if the max height "
+        "decreased,\n");
+    log("which is repeated until the max height stops decreasing. The "
+        "design must be\n");
+    log("flattened and mapped to '$lut' cells.\n");
+    log("\n");
+    log("    -lut <K>\n");
+    log("        LUT size of the delay script. Default is 4.\n");
+    log("\n");
+    log("    -script <file>\n");
+    log("        ABC script used on the cone. Default is the 'BEST' delay "
+        "script for\n");
+    log("        the LUT size.\n");
+    log("\n");
+    log("    -margin <N>\n");
+    log("        Also re-synthesize the LUT cells with a slack up to N. "
+        "Default is 0,\n");
+    log("        the critical paths only.\n");
+    log("\n");
+    log("    -depth <N>\n");
+    log("        Stop as soon as the max height is N or less. N is only a "
+        "stop criterion,\n");
+    log("        it is not passed to ABC : the cone is mapped by the delay "
+        "script alone.\n");
+    log("\n");
+    log("    -max_iter <N>\n");
+    log("        Max number of re-synthesis iterations. Default is 5.\n");
+    log("\n");
+    log("The final max height is stored in the scratchpad "
+        "('cp_resynth.max_height').\n");
+    log("\n");
+  }
+
+  // ---------------------
+  // clear_flags
+  // ---------------------
+  void clear_flags() override {
+    lut_size = "4";
+    abc_script = "";
+    margin = 0;
+    depth = 0;
+    max_iter = 5;
+  }
+
+  // ---------------------
+  // execute
+  // ---------------------
+  void execute(std::vector<std::string> args, RTLIL::Design *design) override {
+    string run_from, run_to;
+
+    clear_flags();
+
+    log_header(design, "Executing 'cp_resynth' command (re-synthesize the "
+                       "critical LUT cone).\n");
+
+    size_t argidx;
+
+    G_design = design;
+
+    for (argidx = 1; argidx < args.size(); argidx++) {
+      if (args[argidx] == "-lut" && argidx + 1 < args.size()) {
+        lut_size = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-script" && argidx + 1 < args.size()) {
+        abc_script = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-margin" && argidx + 1 < args.size()) {
+        margin = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-depth" && argidx + 1 < args.size()) {
+        depth = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-max_iter" && argidx + 1 < args.size()) {
+        max_iter = atoi(args[++argidx].c_str());
+        continue;
+      }
+      break;
+    }
+
+    extra_args(args, argidx, design);
+
+    if (margin < 0) {
+      log_cmd_error("Invalid slack margin %d.\n", margin);
+    }
+
+    if (abc_script.empty()) {
+      abc_script = "+/plugins/wildebeest/abc_scripts/LUT" + lut_size +
+                   "/BEST/delay_lut" + lut_size + ".scr";
+    }
+
+    run_script(design, run_from, run_to);
+  }
+
+  // ---------------------
+  // get_max_height
+  // ---------------------
+  // Run 'max_height' on 'top' and annotate its LUT cells with their slack.
+  //
+  int get_max_height(Module *top) {
+    run(stringf("max_height -slack %s", log_id(top->name)));
+
+    return G_design->scratchpad_get_int("max_height.max_height");
+  }
+
+  // ---------------------
+  // resynth_cone
+  // ---------------------
+  // Move the LUT cells within 'margin' of the critical paths into a sub
+  // module, re-map it with the delay script and flatten it back. Return
+  // false if the cone is empty.
+  //
+  bool resynth_cone(Module *top) {
+    string cone = stringf("%s/a:max_height_slack=0", log_id(top->name));
+
+    for (int slack = 1; slack <= margin; slack++) {
+      cone += stringf(" %s/a:max_height_slack=%d", log_id(top->name), slack);
+    }
+
+    run("select -set cp_resynth_cone " + cone);
+
+    int nb_cells = 0;
+
+    for (auto cell : top->cells()) {
+      auto it = cell->attributes.find(ID(max_height_slack));
+
+      if ((it != cell->attributes.end()) && (it->second.as_int() <= margin)) {
+        nb_cells++;
+      }
+    }
+
+    log("   Critical cone : %d LUT cells.\n", nb_cells);
+
+    if (!nb_cells) {
+      return false;
+    }
+
+    run("submod -name cp_resynth_cone @cp_resynth_cone");
+    run("lut2mux cp_resynth_cone");
+    run("abc -script " + abc_script + " cp_resynth_cone");
+    run("opt_clean cp_resynth_cone");
+    run("flatten");
+    run("opt_clean");
+
+    return true;
+  }
+
+  // ---------------------
+  // script
+  // ---------------------
+  void script() override {
+    if (!G_design) {
+      log_warning("Design seems empty !\n");
+      return;
+    }
+
+    Module *top = G_design->top_module();
+
+    if (!top) {
+      log_cmd_error("'cp_resynth' needs a flattened design with a top "
+                    "module.\n");
+    }
+
+    IdString top_name = top->name;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    int max_height = get_max_height(top);
+    int start_height = max_height;
+    int iter = 0;
+    bool saved = false;
+
+    while (iter < max_iter) {
+
+      if (depth && (max_height <= depth)) {
+        log("   Depth target %d reached.\n", depth);
+        break;
+      }
+
+      log("\n");
+      log("   Iteration %d : max height = %d\n", iter + 1, max_height);
+
+      // Keep the current netlist to restore it if the re-synthesis does
+      // not improve the max height.
+      //
+      run("design -save cp_resynth");
+      saved = true;
+
+      if (!resynth_cone(G_design->module(top_name))) {
+        run("design -load cp_resynth");
+        break;
+      }
+
+      int height = get_max_height(G_design->module(top_name));
+
+      if (height >= max_height) {
+        log("   Max height %d is not better than %d, restoring the "
+            "netlist.\n",
+            height, max_height);
+        run("design -load cp_resynth");
+        break;
+      }
+
+      max_height = height;
+      iter++;
+    }
+
+    if (saved) {
+      run("design -delete cp_resynth");
+    }
+
+    run(stringf("setattr -unset max_height_slack %s", log_id(top_name)));
+
+    G_design->scratchpad_set_int("cp_resynth.max_height", max_height);
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        endTime - startTime);
+
+    float totalTime = elapsed.count() * 1e-9;
+
+    log("\n");
+    log("   Max height                 = %d -> %d\n", start_height,
+        max_height);
+    log("   Improving iterations       = %d\n", iter);
+    log("   [Run Time = %.1f sec.]\n", totalTime);
+  }
+
+} CpResynthPass;
+
+PRIVATE_NAMESPACE_END
@@ -0,0 +1,468 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "design_stats.h"
+#include "cell_library.h"
+#include "kernel/log.h"
+#include "kernel/register.h"
+#include "kernel/rtlil.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+DesignStats::DesignStats(RTLIL::Design *design) : design(design) {
+  for (auto module : design->modules()) {
+    recount(module);
+  }
+
+  design->monitors.insert(this);
+}
+
+// -------------------------
+// get
+// -------------------------
+//
+DesignStats *DesignStats::get(RTLIL::Design *design) {
+  DesignStats *stats = find(design);
+
+  return stats ? stats : new DesignStats(design);
+}
+
+// -------------------------
+// find
+// -------------------------
+//
+DesignStats *DesignStats::find(RTLIL::Design *design) {
+  for (auto mon : design->monitors) {
+    DesignStats *stats = dynamic_cast<DesignStats *>(mon);
+    if (stats) {
+      return stats;
+    }
+  }
+
+  return nullptr;
+}
+
+// -------------------------
+// release
+// -------------------------
+//
+void DesignStats::release(RTLIL::Design *design) {
+  DesignStats *stats = find(design);
+
+  if (!stats) {
+    return;
+  }
+
+  design->monitors.erase(stats);
+  delete stats;
+}
+
+// -------------------------
+// recount
+// -------------------------
+//
+void DesignStats::recount(RTLIL::Module *module) {
+  auto &cells = module_cells[module];
+  auto &types = module_types[module];
+
+  cells.clear();
+  types.clear();
+
+  for (auto cell : module->cells()) {
+    cells[cell] = cell->type;
+    types[cell->type]++;
+  }
+}
+
+// -------------------------
+// recount_design
+// -------------------------
+//
+void DesignStats::recount_design() {
+  module_cells.clear();
+  module_types.clear();
+
+  for (auto module : design->modules()) {
+    recount(module);
+  }
+}
+
+// -------------------------
+// sync
+// -------------------------
+//
+// Only the live cells are looked at : the tracked pointers of cells
+// removed without notification may be dangling.
+//
+void DesignStats::sync(RTLIL::Module *module) {
+  auto &cells = module_cells[module];
+
+  if (GetSize(cells) != GetSize(module->cells_)) {
+    recount(module);
+    return;
+  }
+
+  for (auto cell : module->cells()) {
+
+    auto it = cells.find(cell);
+
+    if ((it == cells.end()) || (it->second != cell->type)) {
+      recount(module);
+      return;
+    }
+  }
+}
+
+void DesignStats::notify_module_add(RTLIL::Module *module) {
+  recount(module);
+}
+
+void DesignStats::notify_module_del(RTLIL::Module *module) {
+  module_cells.erase(module);
+  module_types.erase(module);
+}
+
+void DesignStats::notify_blackout(RTLIL::Module *module) {
+  module_cells[module].clear();
+  module_types[module].clear();
+}
+
+// -------------------------
+// notify_connect
+// -------------------------
+// Called before the port change is applied : on a disconnection 'sig' is
+// empty and the port is still in 'cell->connections()'.
+//
+void DesignStats::notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &,
+                                 const RTLIL::SigSpec &,
+                                 const RTLIL::SigSpec &sig) {
+  RTLIL::Module *module = cell->module;
+
+  auto &cells = module_cells[module];
+  auto &types = module_types[module];
+
+  auto it = cells.find(cell);
+
+  // Last port disconnected : the cell is being removed.
+  //
+  if (sig.empty() && (cell->connections().size() == 1)) {
+
+    if (it != cells.end()) {
+      if (--types[it->second] == 0) {
+        types.erase(it->second);
+      }
+      cells.erase(it);
+    }
+    return;
+  }
+
+  if (it == cells.end()) {
+    cells[cell] = cell->type;
+    types[cell->type]++;
+    return;
+  }
+
+  // Cell type changed in place (ex: 'opt_expr', 'dfflegalize').
+  //
+  if (it->second != cell->type) {
+    if (--types[it->second] == 0) {
+      types.erase(it->second);
+    }
+    types[cell->type]++;
+    it->second = cell->type;
+  }
+}
+
+int DesignStats::nb_cells(RTLIL::Module *module) {
+  sync(module);
+
+  return GetSize(module_cells[module]);
+}
+
+int DesignStats::nb_cells(RTLIL::Module *module, RTLIL::IdString type) {
+  sync(module);
+
+  return module_types[module].at(type, 0);
+}
+
+int DesignStats::nb_design_cells() {
+  int nb = 0;
+
+  for (auto module : design->modules()) {
+    sync(module);
+    nb += GetSize(module_cells[module]);
+  }
+
+  return nb;
+}
+
+const dict<RTLIL::IdString, int> &
+DesignStats::cell_types(RTLIL::Module *module) {
+  sync(module);
+
+  return module_types[module];
+}
+
+int DesignStats::nb_luts(RTLIL::Module *module) {
+  sync(module);
+
+  int nb = 0;
+
+  for (auto &it : module_types[module]) {
+    nb += CellLibrary::get().lut_weight(it.first) * it.second;
+  }
+
+  return nb;
+}
+
+int DesignStats::nb_dffs(RTLIL::Module *module) {
+  sync(module);
+
+  int nb = 0;
+
+  for (auto &it : module_types[module]) {
+    if (CellLibrary::get().is_dff(it.first)) {
+      nb += it.second;
+    }
+  }
+
+  return nb;
+}
+
+int DesignStats::nb_dsps(RTLIL::Module *module) {
+  sync(module);
+
+  int nb = 0;
+
+  for (auto &it : module_types[module]) {
+    if (CellLibrary::get().is_dsp(it.first)) {
+      nb += it.second;
+    }
+  }
+
+  return nb;
+}
+
+int DesignStats::nb_brams(RTLIL::Module *module) {
+  sync(module);
+
+  int nb = 0;
+
+  for (auto &it : module_types[module]) {
+    if (CellLibrary::get().is_bram(it.first)) {
+      nb += it.second;
+    }
+  }
+
+  return nb;
+}
+
+int DesignStats::nb_wire_bits(RTLIL::Module *module) {
+  int nb = 0;
+
+  for (auto wire : module->wires()) {
+    nb += wire->width;
+  }
+
+  return nb;
+}
+
+// -------------------------
+// log_summary
+// -------------------------
+//
+void DesignStats::log_summary(RTLIL::Module *module, bool show_types) {
+  sync(module);
+
+  log("\n");
+  log("   Module %s\n", log_id(module->name));
+  log("   Number of cells      : %9d\n", nb_cells(module));
+  log("   Number of cell types : %9d\n", GetSize(module_types[module]));
+  log("   Number of LUTs       : %9d\n", nb_luts(module));
+  log("   Number of DFFs       : %9d\n", nb_dffs(module));
+  log("   Number of DSPs       : %9d\n", nb_dsps(module));
+  log("   Number of BRAMs      : %9d\n", nb_brams(module));
+  log("   Number of wire bits  : %9d\n", nb_wire_bits(module));
+
+  if (!show_types) {
+    return;
+  }
+
+  vector<std::pair<RTLIL::IdString, int>> sorted(module_types[module].begin(),
+                                                 module_types[module].end());
+
+  std::sort(sorted.begin(), sorted.end(),
+            [](const std::pair<RTLIL::IdString, int> &a,
+               const std::pair<RTLIL::IdString, int> &b) {
+              return a.first.str() < b.first.str();
+            });
+
+  log("\n");
+  for (auto &it : sorted) {
+    log("     %9d   %s\n", it.second, log_id(it.first));
+  }
+}
+
+// -------------------------
+// verify
+// -------------------------
+//
+int DesignStats::verify() {
+  int nb_errors = 0;
+
+  for (auto module : design->modules()) {
+
+    sync(module);
+
+    dict<RTLIL::IdString, int> types;
+
+    for (auto cell : module->cells()) {
+      types[cell->type]++;
+    }
+
+    pool<RTLIL::IdString> all_types;
+    for (auto &it : types) {
+      all_types.insert(it.first);
+    }
+    for (auto &it : module_types[module]) {
+      all_types.insert(it.first);
+    }
+
+    for (auto type : all_types) {
+      int expected = types.at(type, 0);
+      int tracked = module_types[module].at(type, 0);
+
+      if (expected != tracked) {
+        log_warning("Module %s : %d '%s' cells tracked instead of %d.\n",
+                    log_id(module->name), tracked, log_id(type), expected);
+        nb_errors++;
+      }
+    }
+
+    if (GetSize(module_cells[module]) != GetSize(module->cells_)) {
+      log_warning("Module %s : %d cells tracked instead of %d.\n",
+                  log_id(module->name), GetSize(module_cells[module]),
+                  GetSize(module->cells_));
+      nb_errors++;
+    }
+
+    recount(module);
+  }
+
+  return nb_errors;
+}
+
+YOSYS_NAMESPACE_END
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+struct DesignStatsPass : public Pass {
+  DesignStatsPass()
+      : Pass("design_stats", "Show incrementally maintained design stats") {}
+
+  void help() override {
+    //   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+    log("\n");
+    log("    design_stats [options] [selection]\n");
+    log("\n");
+    log("This command shows cells, LUTs, DFFs, DSPs, BRAMs and wire bits "
+        "counts of\n");
+    log("the selected modules. Counts are maintained incrementally while the "
+        "tracker\n");
+    log("is attached to the design ('synth_fpga' attaches it for its run, "
+        "unless it\n");
+    log("is already attached). Otherwise the design is counted for this "
+        "command only.\n");
+    log("\n");
+    log("    -attach\n");
+    log("        keep the tracker attached to the design after this command, "
+        "until\n");
+    log("        'design_stats -detach'.\n");
+    log("\n");
+    log("    -detach\n");
+    log("        detach and delete the tracker.\n");
+    log("\n");
+    log("    -types\n");
+    log("        also show the number of cells per cell type.\n");
+    log("\n");
+    log("    -verify\n");
+    log("        compare the incremental counts with a full recount of the "
+        "design and\n");
+    log("        error out on mismatch.\n");
+    log("\n");
+  }
+
+  void execute(std::vector<std::string> args, RTLIL::Design *design) override {
+    bool types = false;
+    bool verify = false;
+    bool attach = false;
+    bool detach = false;
+
+    log_header(design, "Executing 'design_stats'.\n");
+
+    size_t argidx;
+    for (argidx = 1; argidx < args.size(); argidx++) {
+      if (args[argidx] == "-types") {
+        types = true;
+        continue;
+      }
+      if (args[argidx] == "-verify") {
+        verify = true;
+        continue;
+      }
+      if (args[argidx] == "-attach") {
+        attach = true;
+        continue;
+      }
+      if (args[argidx] == "-detach") {
+        detach = true;
+        continue;
+      }
+      break;
+    }
+    extra_args(args, argidx, design);
+
+    if (detach) {
+      DesignStats::release(design);
+      return;
+    }
+
+    bool attached = DesignStats::find(design) != nullptr;
+
+    DesignStats *stats = DesignStats::get(design);
+
+    if (verify) {
+      int nb_errors = stats->verify();
+      if (nb_errors) {
+        log_error("%d mismatches in incremental design stats.\n", nb_errors);
+      }
+      log("\n   Incremental design stats are consistent.\n");
+    }
+
+    for (auto module : design->selected_modules()) {
+      stats->log_summary(module, types);
+    }
+
+    if (!attached && !attach) {
+      DesignStats::release(design);
+    }
+  }
+} DesignStatsPass;
+
+PRIVATE_NAMESPACE_END
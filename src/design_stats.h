@@ -0,0 +1,103 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef DESIGN_STATS_H
+#define DESIGN_STATS_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// Design statistics kept up to date through netlist change notifications so
+// that cell counts do not need a full walk of the design each time they are
+// queried (see 'stat' calls in 'synth_fpga').
+//
+// A cell is counted when its first port gets connected and uncounted when
+// its last port gets disconnected, which is what 'Module::remove' does.
+// A cell type changed in place is fixed up on its next port change.
+//
+// Cells copied with their 'connections_' written directly (ex: 'flatten')
+// and types changed without port change (ex: 'chtype') are not notified : a
+// module whose cells or types differ from the tracked ones is recounted
+// when queried, and 'recount_design' is run after such passes.
+//
+// The statistics belong to whoever attached them ('synth_fpga' for its run,
+// 'design_stats -attach'), which detaches and deletes them with 'release'.
+//
+struct DesignStats : public RTLIL::Monitor {
+  RTLIL::Design *design;
+
+  // Per module : cell -> type it is counted as, and cell counts per type.
+  //
+  dict<RTLIL::Module *, dict<RTLIL::Cell *, RTLIL::IdString>> module_cells;
+  dict<RTLIL::Module *, dict<RTLIL::IdString, int>> module_types;
+
+  DesignStats(RTLIL::Design *design);
+
+  // Return the statistics attached to 'design', attach them if needed.
+  //
+  static DesignStats *get(RTLIL::Design *design);
+
+  // Statistics attached to 'design', null if none.
+  //
+  static DesignStats *find(RTLIL::Design *design);
+
+  // Detach the statistics of 'design', if any, and delete them.
+  //
+  static void release(RTLIL::Design *design);
+
+  void recount(RTLIL::Module *module);
+  void recount_design();
+
+  // Recount 'module' if its tracked cells or their types are not the real
+  // ones.
+  //
+  void sync(RTLIL::Module *module);
+
+  void notify_module_add(RTLIL::Module *module) override;
+  void notify_module_del(RTLIL::Module *module) override;
+  void notify_blackout(RTLIL::Module *module) override;
+  void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port,
+                      const RTLIL::SigSpec &old_sig,
+                      const RTLIL::SigSpec &sig) override;
+
+  int nb_cells(RTLIL::Module *module);
+  int nb_cells(RTLIL::Module *module, RTLIL::IdString type);
+  int nb_design_cells();
+  const dict<RTLIL::IdString, int> &cell_types(RTLIL::Module *module);
+
+  int nb_luts(RTLIL::Module *module);
+  int nb_dffs(RTLIL::Module *module);
+  int nb_dsps(RTLIL::Module *module);
+  int nb_brams(RTLIL::Module *module);
+
+  // Monitors get no wire notifications : computed on demand.
+  //
+  int nb_wire_bits(RTLIL::Module *module);
+
+  void log_summary(RTLIL::Module *module, bool show_types = false);
+
+  // Compare with a full recount of the design. Return the number of
+  // mismatching (module, type) counts.
+  //
+  int verify();
+};
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,306 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef JSON_NODE_H
+#define JSON_NODE_H
+
+#include "kernel/yosys.h"
+
+YOSYS_NAMESPACE_BEGIN
+
+// -------------------------
+// Json reader
+// -------------------------
+// Json node that stores sections of the synthesis 'config' file.
+//
+struct JsonNode {
+  char type; // S=String, N=Number, A=Array, D=Dict
+  string data_string;
+  int64_t data_number;
+  vector<JsonNode *> data_array;
+  dict<string, JsonNode *> data_dict;
+  vector<string> data_dict_keys;
+
+  JsonNode(std::istream &f, string &cf_file, int &line) {
+    type = 0;
+    data_number = 0;
+
+    while (1) {
+      int ch = f.get();
+
+      if (ch == EOF)
+        log_error("Unexpected EOF in JSON file.\n");
+
+      if (ch == '\n')
+        line++;
+      if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
+        continue;
+
+      if (ch == '"') {
+        type = 'S';
+
+        while (1) {
+          ch = f.get();
+
+          if (ch == EOF)
+            log_error("Unexpected EOF in JSON string.\n");
+
+          if (ch == '"')
+            break;
+
+          if (ch == '\\') {
+            ch = f.get();
+
+            switch (ch) {
+            case EOF:
+              log_error("Unexpected EOF in JSON string.\n");
+              break;
+            case '"':
+            case '/':
+            case '\\':
+              break;
+            case 'b':
+              ch = '\b';
+              break;
+            case 'f':
+              ch = '\f';
+              break;
+            case 'n':
+              ch = '\n';
+              break;
+            case 'r':
+              ch = '\r';
+              break;
+            case 't':
+              ch = '\t';
+              break;
+            case 'u':
+              int val = 0;
+              for (int i = 0; i < 4; i++) {
+                ch = f.get();
+                val <<= 4;
+                if (ch >= '0' && '9' >= ch) {
+                  val += ch - '0';
+                } else if (ch >= 'A' && 'F' >= ch) {
+                  val += 10 + ch - 'A';
+                } else if (ch >= 'a' && 'f' >= ch) {
+                  val += 10 + ch - 'a';
+                } else
+                  log_error("Unexpected non-digit character in \\uXXXX "
+                            "sequence: %c at line %d.\n",
+                            ch, line);
+              }
+              if (val < 128)
+                ch = val;
+              else
+                log_error("Unsupported \\uXXXX sequence in JSON string: %04X "
+                          "at line %d.\n",
+                          val, line);
+              break;
+            }
+          }
+
+          data_string += ch;
+        }
+
+        break;
+      }
+
+      if (('0' <= ch && ch <= '9') || ch == '-') {
+        bool negative = false;
+        type = 'N';
+        if (ch == '-') {
+          data_number = 0;
+          negative = true;
+        } else {
+          data_number = ch - '0';
+        }
+
+        data_string += ch;
+
+        while (1) {
+          ch = f.get();
+
+          if (ch == EOF)
+            break;
+
+          if (ch == '.')
+            goto parse_real;
+
+          if (ch < '0' || '9' < ch) {
+            f.unget();
+            break;
+          }
+
+          data_number = data_number * 10 + (ch - '0');
+          data_string += ch;
+        }
+
+        data_number = negative ? -data_number : data_number;
+        data_string = "";
+        break;
+
+      parse_real:
+        type = 'S';
+        data_number = 0;
+        data_string += ch;
+
+        while (1) {
+          ch = f.get();
+
+          if (ch == EOF)
+            break;
+
+          if (ch < '0' || '9' < ch) {
+            f.unget();
+            break;
+          }
+
+          data_string += ch;
+        }
+
+        break;
+      }
+
+      if (ch == '[') {
+        type = 'A';
+
+        while (1) {
+          ch = f.get();
+
+          if (ch == EOF)
+            log_error("Unexpected EOF in JSON file '%s'.\n", cf_file.c_str());
+
+          if (ch == '\n')
+            line++;
+
+          if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
+              ch == ',')
+            continue;
+
+          if (ch == ']')
+            break;
+
+          f.unget();
+          data_array.push_back(new JsonNode(f, cf_file, line));
+        }
+
+        break;
+      }
+
+      if (ch == '{') {
+        type = 'D';
+
+        while (1) {
+          ch = f.get();
+
+          if (ch == EOF)
+            log_error("Unexpected EOF in JSON file '%s'.\n", cf_file.c_str());
+
+          if (ch == '\n')
+            line++;
+
+          if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
+              ch == ',')
+            continue;
+
+          if (ch == '}')
+            break;
+
+          f.unget();
+          JsonNode key(f, cf_file, line);
+
+          while (1) {
+            ch = f.get();
+
+            if (ch == EOF)
+              log_error("Unexpected EOF in JSON file '%s'.\n",
+                        cf_file.c_str());
+
+            if (ch == '\n')
+              line++;
+
+            if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
+                ch == ':')
+              continue;
+
+            f.unget();
+            break;
+          }
+
+          JsonNode *value = new JsonNode(f, cf_file, line);
+
+          if (key.type != 'S')
+            log_error("Unexpected non-string key in JSON dict at line %d.\n",
+                      line);
+
+          data_dict[key.data_string] = value;
+          data_dict_keys.push_back(key.data_string);
+        }
+
+        break;
+      }
+
+      log_error("Unexpected character '%c' in config file '%s' at line %d.\n",
+                ch, cf_file.c_str(), line);
+    }
+  }
+
+  ~JsonNode() {
+    for (auto it : data_array)
+      delete it;
+    for (auto &it : data_dict)
+      delete it.second;
+  }
+};
+
+// Number value of a node : integers are 'N' nodes and reals are kept as 'S'
+// nodes by the reader.
+//
+inline double json_number(const JsonNode *node) {
+  if (node->type == 'N') {
+    return node->data_number;
+  }
+
+  return atof(node->data_string.c_str());
+}
+
+// Escape 's' to be written as a JSON string.
+//
+inline std::string json_escape(const std::string &s) {
+  std::string res;
+
+  for (char ch : s) {
+    if (ch == '"' || ch == '\\') {
+      res += '\\';
+      res += ch;
+      continue;
+    }
+    if (ch == '\n') {
+      res += "\\n";
+      continue;
+    }
+    res += ch;
+  }
+
+  return res;
+}
+
+YOSYS_NAMESPACE_END
+
+#endif
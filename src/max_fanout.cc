@@ -0,0 +1,567 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+//
+#include "kernel/sigtools.h"
+#include "kernel/yosys.h"
+#include "cell_library.h"
+#include "timing_graph.h"
+#include <chrono>
+#include <fstream>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+static int topn = 10;
+static int margin = -1;
+static int limit = 0;
+
+// Yosys internal DFF types that can be duplicated besides the DFFs of the
+// parts : the 'legalize_list' patterns of the config file.
+//
+static vector<string> legal_flops;
+
+struct MaxFanoutWorker {
+  RTLIL::Design *design;
+  RTLIL::Module *module;
+
+  // LUT bit graph giving the slack of the nets relative to the max height,
+  // and its SigMap, shared through the design 'TimingMonitor' cache.
+  //
+  SigMap &sigmap;
+  TimingGraph &graph;
+
+  // Readers of a driven bit : a cell input port bit.
+  //
+  typedef struct {
+    Cell *cell;
+    IdString port;
+    int offset;
+  } sink;
+
+  dict<SigBit, Cell *> drivers;
+  dict<SigBit, vector<sink>> sinks;
+  dict<SigBit, int> outputs;
+
+  // Bits driven by module input ports : reported but not splittable.
+  //
+  pool<SigBit> inputs;
+
+  // Bits read by a clock port : reported but not splittable, the clock
+  // nets are left to the clock network of the part.
+  //
+  pool<SigBit> clocks;
+
+  // High fanout nets, highest fanout first.
+  //
+  vector<SigBit> nets;
+
+  int max_height = 0;
+  int nb_dups = 0;
+  int nb_split = 0;
+
+  // ---------------------
+  // MaxFanoutWorker
+  // ---------------------
+  //
+  MaxFanoutWorker(RTLIL::Module *module)
+      : design(module->design), module(module),
+        sigmap(TimingMonitor::get(module->design)->sigmap(module)),
+        graph(TimingMonitor::get(module->design)->graph(module, "max_fanout")) {
+    build();
+  }
+
+  // ---------------------
+  // build
+  // ---------------------
+  // Levelize the LUT graph and collect the drivers and readers of the nets,
+  // again after each split round.
+  //
+  void build() {
+    drivers.clear();
+    sinks.clear();
+    outputs.clear();
+    inputs.clear();
+    clocks.clear();
+    max_height = 0;
+
+    // Same cells as 'max_height' so that the slacks match.
+    //
+    auto traversable = [](Cell *cell) {
+      return CellLibrary::get().is_lut_logic(cell->type);
+    };
+
+    TimingMonitor::get(design)->levelize(module, "max_fanout", traversable,
+                                         false, 1, false);
+
+    graph.compute_heights();
+
+    for (int n = 0; n < graph.nb_nodes(); n++) {
+      max_height = std::max(max_height, graph.height[n]);
+    }
+
+    graph.compute_required(max_height);
+
+    for (auto cell : module->cells()) {
+
+      for (auto &conn : cell->connections()) {
+
+        if (cell->output(conn.first)) {
+          for (auto bit : sigmap(conn.second)) {
+            if (bit.wire) {
+              drivers[bit] = cell;
+            }
+          }
+          continue;
+        }
+
+        if (!cell->input(conn.first)) {
+          continue;
+        }
+
+        for (int i = 0; i < GetSize(conn.second); i++) {
+
+          SigBit bit = sigmap(conn.second[i]);
+
+          if (!bit.wire) {
+            continue;
+          }
+
+          sinks[bit].push_back({cell, conn.first, i});
+
+          if (CellLibrary::is_clock_port(conn.first)) {
+            clocks.insert(bit);
+          }
+        }
+      }
+    }
+
+    for (auto wire : module->wires()) {
+
+      if (wire->port_input) {
+        for (auto bit : sigmap(wire)) {
+          if (bit.wire && !drivers.count(bit)) {
+            inputs.insert(bit);
+          }
+        }
+      }
+
+      if (!wire->port_output) {
+        continue;
+      }
+
+      for (auto bit : sigmap(wire)) {
+        outputs[bit]++;
+      }
+    }
+  }
+
+  int fanout(SigBit bit) {
+    int fo = outputs.count(bit) ? outputs.at(bit) : 0;
+
+    return fo + (sinks.count(bit) ? GetSize(sinks.at(bit)) : 0);
+  }
+
+  // Slack of the LUT net 'bit', -1 if it does not feed a LUT.
+  //
+  int slack(SigBit bit) {
+    int n = graph.node(bit);
+
+    return (n < 0) ? -1 : graph.required[n] - graph.height[n];
+  }
+
+  // ---------------------
+  // get_nets
+  // ---------------------
+  // Nets driven by a cell or an input port with more than one reader. With
+  // 'margin', only the nets feeding LUTs with a slack up to 'margin' are
+  // kept.
+  //
+  void get_nets() {
+    vector<SigBit> driven;
+
+    nets.clear();
+
+    for (auto &it : drivers) {
+      driven.push_back(it.first);
+    }
+
+    driven.insert(driven.end(), inputs.begin(), inputs.end());
+
+    for (auto bit : driven) {
+
+      if (fanout(bit) < 2) {
+        continue;
+      }
+
+      if (margin >= 0) {
+        int s = slack(bit);
+
+        if ((s < 0) || (s > margin)) {
+          continue;
+        }
+      }
+
+      nets.push_back(bit);
+    }
+
+    std::stable_sort(nets.begin(), nets.end(), [&](SigBit a, SigBit b) {
+      return fanout(a) > fanout(b);
+    });
+  }
+
+  // ---------------------
+  // report_nets
+  // ---------------------
+  void report_nets() {
+    log("\n");
+    log("   Top %d high fanout nets in %s (max height %d)\n", topn,
+        log_id(module), max_height);
+    log("   ------------------------------------------------\n");
+    log("   %8s %6s   %s\n", "fanout", "slack", "net / driver");
+
+    for (int i = 0; (i < topn) && (i < GetSize(nets)); i++) {
+
+      SigBit bit = nets[i];
+      int s = slack(bit);
+      string slack_str = (s < 0) ? "-" : std::to_string(s);
+
+      if (!drivers.count(bit)) {
+        log("   %8d %6s   %s / input port (not splittable)\n", fanout(bit),
+            slack_str.c_str(), log_signal(bit));
+        continue;
+      }
+
+      Cell *cell = drivers.at(bit);
+
+      log("   %8d %6s   %s / %s (%s)%s\n", fanout(bit), slack_str.c_str(),
+          log_signal(bit), log_id(cell->name), log_id(cell->type),
+          clocks.count(bit) ? " clock (not splittable)" : "");
+    }
+  }
+
+  // ---------------------
+  // can_duplicate
+  // ---------------------
+  // Cells with a single output bit, not kept, that are LUTs or legal DFFs.
+  //
+  bool can_duplicate(Cell *cell, SigBit bit) {
+    if (cell->get_bool_attribute(ID::keep)) {
+      return false;
+    }
+
+    if (bit.wire->get_bool_attribute(ID::keep)) {
+      return false;
+    }
+
+    int nb_outputs = 0;
+
+    for (auto &conn : cell->connections()) {
+      if (cell->output(conn.first)) {
+        nb_outputs += GetSize(conn.second);
+      }
+    }
+
+    if (nb_outputs != 1) {
+      return false;
+    }
+
+    CellLibrary &library = CellLibrary::get();
+
+    if (library.is_lut(cell->type) ||
+        library.has(cell->type, CellLibrary::FF)) {
+      return true;
+    }
+
+    if (!cell->is_builtin_ff()) {
+      return false;
+    }
+
+    for (auto &pattern : legal_flops) {
+      if (patmatch(pattern.c_str(), cell->type.c_str())) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // ---------------------
+  // split_net
+  // ---------------------
+  // Keep 'limit' readers on the driver of 'bit' and move each next group of
+  // 'limit' readers to a copy of the driver. Module outputs stay on the
+  // original driver.
+  //
+  void split_net(SigBit bit) {
+    if (!drivers.count(bit) || !sinks.count(bit) || clocks.count(bit)) {
+      return;
+    }
+
+    Cell *cell = drivers.at(bit);
+
+    if (!can_duplicate(cell, bit)) {
+      return;
+    }
+
+    IdString out_port;
+    SigBit out_bit;
+
+    for (auto &conn : cell->connections()) {
+      if (cell->output(conn.first)) {
+        out_port = conn.first;
+        out_bit = conn.second[0];
+      }
+    }
+
+    vector<sink> &readers = sinks.at(bit);
+
+    int first =
+        std::max(0, limit - (outputs.count(bit) ? outputs.at(bit) : 0));
+
+    for (int i = first; i < GetSize(readers); i += limit) {
+
+      Cell *dup = module->addCell(NEW_ID, cell);
+      Wire *wire = module->addWire(NEW_ID);
+
+      // Keep the DFF initial value
+      //
+      if (out_bit.wire && out_bit.wire->attributes.count(ID::init)) {
+        Const init = out_bit.wire->attributes.at(ID::init);
+        wire->attributes[ID::init] = Const(init[out_bit.offset]);
+      }
+
+      dup->setPort(out_port, wire);
+
+      for (int j = i; (j < i + limit) && (j < GetSize(readers)); j++) {
+
+        SigSpec sig = readers[j].cell->getPort(readers[j].port);
+        sig[readers[j].offset] = wire;
+        readers[j].cell->setPort(readers[j].port, sig);
+      }
+
+      nb_dups++;
+    }
+
+    nb_split++;
+  }
+
+  // ---------------------
+  // run
+  // ---------------------
+  void run() {
+    get_nets();
+
+    report_nets();
+
+    int max_fanout = nets.empty() ? 0 : fanout(nets[0]);
+
+    design->scratchpad_set_int("max_fanout.max_fanout", max_fanout);
+
+    if (limit > 0) {
+
+      // Each copy adds readers to the input nets of its driver : the nets
+      // it pushes over the limit are split in the next round. Through DFF
+      // loops this may not converge, so the copies are bounded by the
+      // module size.
+      //
+      int max_dups = GetSize(module->cells());
+
+      for (;;) {
+
+        int nb_split_before = nb_split;
+
+        for (auto bit : nets) {
+
+          if (fanout(bit) <= limit) {
+            break;
+          }
+
+          split_net(bit);
+        }
+
+        if (nb_split == nb_split_before) {
+          break;
+        }
+
+        if (nb_dups > max_dups) {
+          log_warning("Stopped splitting the nets of '%s' after %d "
+                      "duplications.\n",
+                      log_id(module), nb_dups);
+          break;
+        }
+
+        build();
+        get_nets();
+      }
+
+      log("\n");
+      log("   Duplicated %d cells to split %d nets over %d readers.\n",
+          nb_dups, nb_split, limit);
+
+      design->scratchpad_set_int("max_fanout.duplicated", nb_dups);
+    }
+  }
+};
+
+struct MaxFanoutPass : public Pass {
+
+  MaxFanoutPass()
+      : Pass("max_fanout", "report and split high fanout nets") {}
+
+  // ---------------------
+  // help
+  // ---------------------
+  void help() override {
+    //   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+    log("\n");
+    log("    max_fanout [options] [selection]\n");
+    log("\n");
+    log("This command reports the nets with the highest fanout, with their "
+        "slack\n");
+    log("relative to the max LUT height (see 'max_height -slack'), and can "
+        "split them\n");
+    log("by duplicating their driving LUT or DFF. Nets driven by input ports "
+        "and\n");
+    log("nets read by clock ports are reported but cannot be split.\n");
+    log("\n");
+    log("    -top <N>\n");
+    log("        Number of reported nets. Default is 10.\n");
+    log("\n");
+    log("    -margin <N>\n");
+    log("        Only consider the nets feeding LUTs with a slack up to N, "
+        "that is on\n");
+    log("        or near the critical paths.\n");
+    log("\n");
+    log("    -limit <N>\n");
+    log("        Split the nets with more than N readers : each group of N "
+        "readers\n");
+    log("        gets its own copy of the driver. Only single output LUTs "
+        "and DFFs\n");
+    log("        without 'keep' attribute, driving nets without 'keep' "
+        "attribute, are\n");
+    log("        duplicated. The copies add readers to the input nets of the "
+        "driver :\n");
+    log("        the nets they push over N are split again, until the copies "
+        "outnumber\n");
+    log("        the cells of the module.\n");
+    log("\n");
+    log("    -config <file>\n");
+    log("        Also duplicate the Yosys internal DFFs matching the "
+        "'flipflops'\n");
+    log("        'legalize_list' of the config file. Otherwise only the "
+        "DFFs mapped\n");
+    log("        on the part are duplicated.\n");
+    log("\n");
+  }
+
+  // ---------------------
+  // read_legal_flops
+  // ---------------------
+  void read_legal_flops(string file) {
+    std::ifstream f(file);
+
+    if (!f.is_open()) {
+      log_cmd_error("Cannot open config file '%s'.\n", file.c_str());
+    }
+
+    int line = 1;
+    JsonNode root(f, file, line);
+
+    if ((root.type != 'D') || !root.data_dict.count("flipflops")) {
+      log_error("No 'flipflops' section in '%s'.\n", file.c_str());
+    }
+
+    JsonNode *flipflops = root.data_dict.at("flipflops");
+
+    if ((flipflops->type != 'D') ||
+        !flipflops->data_dict.count("legalize_list")) {
+      log_error("No 'legalize_list' in 'flipflops' of '%s'.\n", file.c_str());
+    }
+
+    for (auto it : flipflops->data_dict.at("legalize_list")->data_array) {
+      if (it->type != 'S') {
+        log_error("Array associated to DFF 'legalize_list' must contain "
+                  "only strings.\n");
+      }
+      legal_flops.push_back(it->data_string);
+    }
+  }
+
+  // ---------------------
+  // execute
+  // ---------------------
+  void execute(std::vector<std::string> args, RTLIL::Design *design) override {
+    topn = 10;
+    margin = -1;
+    limit = 0;
+    legal_flops.clear();
+
+    log_header(design, "Executing 'max_fanout' command (report and split high "
+                       "fanout nets).\n");
+
+    size_t argidx;
+
+    for (argidx = 1; argidx < args.size(); argidx++) {
+      if (args[argidx] == "-top" && argidx + 1 < args.size()) {
+        topn = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-margin" && argidx + 1 < args.size()) {
+        margin = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-limit" && argidx + 1 < args.size()) {
+        limit = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-config" && argidx + 1 < args.size()) {
+        read_legal_flops(args[++argidx]);
+        continue;
+      }
+      break;
+    }
+
+    extra_args(args, argidx, design);
+
+    if (limit < 0) {
+      log_cmd_error("Invalid fanout limit %d.\n", limit);
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (Module *module : design->selected_modules()) {
+      if (module->has_processes_warn()) {
+        continue;
+      }
+
+      MaxFanoutWorker worker(module);
+      worker.run();
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        endTime - startTime);
+
+    float totalTime = elapsed.count() * 1e-9;
+
+    log("   [Run Time = %.1f sec.]\n", totalTime);
+  }
+} MaxFanoutPass;
+
+PRIVATE_NAMESPACE_END
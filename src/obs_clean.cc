@@ -19,277 +19,293 @@
 #include "kernel/sigtools.h"
 #include "kernel/yosys.h"
 #include <chrono>
-#include <set>
 
 USING_YOSYS_NAMESPACE
 PRIVATE_NAMESPACE_BEGIN
 
-// Signal cell driver(s), precompute a cell output signal to a cell map
-void sigCellDrivers(RTLIL::Module *module, SigMap &sigmap,
-                    dict<RTLIL::SigSpec, std::set<Cell *>> &sig2CellsInFanout,
-                    dict<RTLIL::SigSpec, std::set<Cell *>> &sig2CellsInFanin) {
-  for (auto cell : module->selected_cells()) {
-    for (auto &conn : cell->connections()) {
-      IdString portName = conn.first;
-      RTLIL::SigSpec actual = conn.second;
-      if (cell->output(portName)) {
-        sig2CellsInFanin[sigmap(actual)].insert(cell);
-        for (int i = 0; i < actual.size(); i++) {
-          SigSpec bit_sig = actual.extract(i, 1);
-          sig2CellsInFanin[sigmap(bit_sig)].insert(cell);
-        }
-      } else {
-        sig2CellsInFanout[sigmap(actual)].insert(cell);
-        for (int i = 0; i < actual.size(); i++) {
-          SigSpec bit_sig = actual.extract(i, 1);
-          if (!bit_sig.is_fully_const()) {
-            sig2CellsInFanout[sigmap(bit_sig)].insert(cell);
-          }
-        }
-      }
+// -------------------------
+// ObsCleanWorker
+// -------------------------
+// Observability sweep of a module on its sigmapped bits : the logic in the
+// transitive fanin of the output ports, the 'keep' wires and the 'keep'
+// cells is observable, the rest is removed. Bits and cells get dense ids so
+// that the sweep is a linear worklist traversal. Since 'SigMap' merges the
+// two sides of the assigns, they need no special handling.
+//
+struct ObsCleanWorker {
+  RTLIL::Module *module;
+  SigMap sigmap;
+  bool debug;
+
+  // Id of each sigmapped wire bit, and cell of each cell id.
+  //
+  dict<SigBit, int> bit2id;
+  vector<Cell *> cells;
+
+  // Driver cell of each bit (-1 if none) and input bits of cell 'c' :
+  // cell_inputs[cell_start[c] .. cell_start[c+1]-1].
+  //
+  vector<int> driver;
+  vector<int> cell_start, cell_inputs;
+
+  vector<bool> observable_bit, observable_cell;
+
+  ObsCleanWorker(RTLIL::Module *module, bool debug)
+      : module(module), sigmap(module), debug(debug) {}
+
+  // ---------------------
+  // bit_id
+  // ---------------------
+  // Id of a sigmapped bit, created if needed. -1 for constants.
+  //
+  int bit_id(SigBit bit) {
+    if (!bit.wire) {
+      return -1;
     }
-  }
-}
-
-// Assign statements fanin, fanout, traces the lhs2rhs and rhs2lhs sigspecs and
-// precompute maps
-void lhs2rhs_rhs2lhs(
-    RTLIL::Module *module, SigMap &sigmap,
-    dict<RTLIL::SigSpec, std::set<RTLIL::SigSpec>> &rhsSig2LhsSig,
-    dict<RTLIL::SigSpec, RTLIL::SigSpec> &lhsSig2rhsSig) {
-  for (auto it = module->connections().begin();
-       it != module->connections().end(); ++it) {
-    RTLIL::SigSpec lhs = it->first;
-    RTLIL::SigSpec rhs = it->second;
-    if (!lhs.is_chunk()) {
-      std::vector<SigSpec> lhsBits;
-      for (int i = 0; i < lhs.size(); i++) {
-        SigSpec bit_sig = lhs.extract(i, 1);
-        lhsBits.push_back(bit_sig);
-      }
-      std::vector<SigSpec> rhsBits;
-      for (int i = 0; i < rhs.size(); i++) {
-        SigSpec bit_sig = rhs.extract(i, 1);
-        rhsBits.push_back(bit_sig);
-      }
 
-      for (uint32_t i = 0; i < lhsBits.size(); i++) {
-        if (i < rhsBits.size()) {
-          rhsSig2LhsSig[sigmap(rhsBits[i])].insert(sigmap(lhsBits[i]));
-          lhsSig2rhsSig[lhsBits[i]] = sigmap(rhsBits[i]);
-        }
-      }
-    } else {
-      rhsSig2LhsSig[sigmap(rhs)].insert(sigmap(lhs));
-      lhsSig2rhsSig[lhs] = sigmap(rhs);
+    auto it = bit2id.find(bit);
+
+    if (it != bit2id.end()) {
+      return it->second;
     }
+
+    int id = GetSize(driver);
+
+    bit2id[bit] = id;
+    driver.push_back(-1);
+
+    return id;
   }
-}
-
-// Collect transitive fanin of a sig
-void collectTransitiveFanin(
-    RTLIL::SigSpec &sig, SigMap &sigmap,
-    dict<RTLIL::SigSpec, std::set<Cell *>> &sig2CellsInFanin,
-    dict<RTLIL::SigSpec, RTLIL::SigSpec> &lhsSig2RhsSig,
-    std::set<Cell *> &visitedCells, std::set<RTLIL::SigSpec> &visitedSigSpec) {
-  if (visitedSigSpec.count(sigmap(sig))) {
-    return;
+
+  bool is_observable(SigBit bit) {
+    auto it = bit2id.find(sigmap(bit));
+
+    return (it != bit2id.end()) && observable_bit[it->second];
   }
-  visitedSigSpec.insert(sigmap(sig));
 
-  if (sig2CellsInFanin.count(sigmap(sig))) {
-    for (Cell *cell : sig2CellsInFanin[sigmap(sig)]) {
-      if (visitedCells.count(cell)) {
-        continue;
-      }
-      visitedCells.insert(cell);
+  // ---------------------
+  // build
+  // ---------------------
+  // Return false if a cell drives a constant : the analysis cannot be
+  // performed correctly.
+  //
+  bool build() {
+    if (debug) {
+      log("Collecting cell info\n");
+      log_flush();
+    }
+
+    for (auto cell : module->cells()) {
+
+      int c = GetSize(cells);
+
+      cells.push_back(cell);
+      cell_start.push_back(GetSize(cell_inputs));
+
       for (auto &conn : cell->connections()) {
-        IdString portName = conn.first;
-        RTLIL::SigSpec actual = conn.second;
-        if (cell->input(portName)) {
-          collectTransitiveFanin(actual, sigmap, sig2CellsInFanin,
-                                 lhsSig2RhsSig, visitedCells, visitedSigSpec);
-          for (int i = 0; i < actual.size(); i++) {
-            SigSpec bit_sig = actual.extract(i, 1);
-            collectTransitiveFanin(bit_sig, sigmap, sig2CellsInFanin,
-                                   lhsSig2RhsSig, visitedCells, visitedSigSpec);
+
+        if (cell->output(conn.first)) {
+
+          for (auto bit : sigmap(conn.second)) {
+
+            int id = bit_id(bit);
+
+            if (id < 0) {
+              log_warning("Module %s contains some logic that prevents "
+                          "obs_clean analysis\n",
+                          module->name.c_str());
+              log_flush();
+              return false;
+            }
+
+            driver[id] = c;
+          }
+          continue;
+        }
+
+        if (!cell->input(conn.first)) {
+          continue;
+        }
+
+        for (auto bit : sigmap(conn.second)) {
+
+          int id = bit_id(bit);
+
+          if (id >= 0) {
+            cell_inputs.push_back(id);
           }
         }
       }
     }
+
+    cell_start.push_back(GetSize(cell_inputs));
+
+    return true;
   }
-  if (lhsSig2RhsSig.count(sigmap(sig))) {
-    RTLIL::SigSpec rhs = lhsSig2RhsSig[sigmap(sig)];
-    collectTransitiveFanin(rhs, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                           visitedCells, visitedSigSpec);
-    for (int i = 0; i < rhs.size(); i++) {
-      SigSpec bit_sig = rhs.extract(i, 1);
-      collectTransitiveFanin(bit_sig, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                             visitedCells, visitedSigSpec);
-    }
-  }
-}
-
-// Only keep the cells and wires that are visited using the transitive fanin
-// reached from output ports or keep signals
-void observabilityClean(
-    RTLIL::Module *module, SigMap &sigmap,
-    dict<RTLIL::SigSpec, std::set<Cell *>> &sig2CellsInFanin,
-    dict<RTLIL::SigSpec, RTLIL::SigSpec> &lhsSig2RhsSig, bool unused_wires,
-    bool unused_assigns, bool debug, dict<RTLIL::IdString, int> &cells2rm) {
-  if (module->get_bool_attribute(ID::keep))
-    return;
-
-  std::set<Cell *> visitedCells;
-  std::set<RTLIL::SigSpec> visitedSigSpec;
-  if (debug) {
-    log("Collecting cell transitive fanin\n");
-    log_flush();
-  }
-  // Collect observable logic (connected to one output)
-  // By cells
-  for (auto elt : sig2CellsInFanin) {
-    RTLIL::SigSpec po = elt.first;
-    if ((!po.size()) || (!po[0].is_wire())) {
-      // Can't perform the analysis correctly.
-      log_warning(
-          "Module %s contains some logic that prevents obs_clean analysis\n",
-          module->name.c_str());
+
+  // ---------------------
+  // mark_observable
+  // ---------------------
+  void mark_observable() {
+    if (debug) {
+      log("Collecting cell transitive fanin\n");
       log_flush();
-      return;
-    }
-    RTLIL::Wire *w = po[0].wire;
-    if (w && (!w->port_output) && (!w->get_bool_attribute(ID::keep))) {
-      continue;
     }
-    RTLIL::SigSpec spo = sigmap(po);
-    collectTransitiveFanin(spo, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                           visitedCells, visitedSigSpec);
-    for (int i = 0; i < po.size(); i++) {
-      SigSpec bit_sig = po.extract(i, 1);
-      bit_sig = sigmap(bit_sig);
-      collectTransitiveFanin(bit_sig, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                             visitedCells, visitedSigSpec);
+
+    // Root bits first since they may get new ids.
+    //
+    vector<int> roots;
+
+    for (auto wire : module->wires()) {
+
+      if (!wire->port_output && !wire->get_bool_attribute(ID::keep)) {
+        continue;
+      }
+
+      for (auto bit : sigmap(wire)) {
+
+        int id = bit_id(bit);
+
+        if (id >= 0) {
+          roots.push_back(id);
+        }
+      }
     }
-  }
 
-  if (debug) {
-    log("Collecting assign transitive fanin\n");
-    log_flush();
-  }
-  // By assigns
-  for (auto elt : lhsSig2RhsSig) {
-    RTLIL::SigSpec po = elt.first;
-    if ((!po.size()) || (!po[0].is_wire())) {
-      // Can't perform the analysis correctly.
-      log_warning(
-          "Module %s contains some logic that prevents obs_clean analysis\n",
-          module->name.c_str());
-      log_flush();
-      return;
+    observable_bit.assign(GetSize(driver), false);
+    observable_cell.assign(GetSize(cells), false);
+
+    vector<int> worklist;
+
+    auto add_bit = [&](int id) {
+      if (!observable_bit[id]) {
+        observable_bit[id] = true;
+        worklist.push_back(id);
+      }
+    };
+
+    auto add_cell = [&](int c) {
+      if (observable_cell[c]) {
+        return;
+      }
+
+      observable_cell[c] = true;
+
+      for (int i = cell_start[c]; i < cell_start[c + 1]; i++) {
+        add_bit(cell_inputs[i]);
+      }
+    };
+
+    for (int id : roots) {
+      add_bit(id);
     }
-    RTLIL::Wire *w = po[0].wire;
-    if (w && (!w->port_output) && (!w->get_bool_attribute(ID::keep))) {
-      continue;
+
+    for (int c = 0; c < GetSize(cells); c++) {
+      if (cells[c]->has_keep_attr()) {
+        add_cell(c);
+      }
     }
-    RTLIL::SigSpec spo = sigmap(po);
-    collectTransitiveFanin(spo, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                           visitedCells, visitedSigSpec);
-    for (int i = 0; i < po.size(); i++) {
-      SigSpec bit_sig = po.extract(i, 1);
-      bit_sig = sigmap(bit_sig);
-      collectTransitiveFanin(bit_sig, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                             visitedCells, visitedSigSpec);
+
+    while (!worklist.empty()) {
+
+      int id = worklist.back();
+      worklist.pop_back();
+
+      if (driver[id] >= 0) {
+        add_cell(driver[id]);
+      }
     }
   }
 
-  if (unused_assigns) {
-    // Remove unused assign stmts
-    if (debug) {
-      log("Removing unused assign\n");
-      log_flush();
-    }
-    std::vector<RTLIL::SigSig> newConnections;
-    for (auto it = module->connections().begin();
-         it != module->connections().end(); ++it) {
-      RTLIL::SigSpec lhs = it->first;
-      if (visitedSigSpec.count(sigmap(lhs))) {
-        newConnections.push_back(*it);
-      } else {
-        for (int i = 0; i < lhs.size(); i++) {
-          SigSpec bit_sig = lhs.extract(i, 1);
-          if (visitedSigSpec.count(sigmap(bit_sig))) {
-            newConnections.push_back(*it);
+  // ---------------------
+  // clean
+  // ---------------------
+  void clean(bool unused_wires, bool unused_assigns,
+             dict<RTLIL::IdString, int> &cells2rm) {
+
+    if (unused_assigns) {
+      // Remove unused assign stmts
+      if (debug) {
+        log("Removing unused assign\n");
+        log_flush();
+      }
+      std::vector<RTLIL::SigSig> newConnections;
+      for (auto &conn : module->connections()) {
+        for (auto bit : conn.first) {
+          if (is_observable(bit)) {
+            newConnections.push_back(conn);
             break;
           }
         }
       }
+
+      module->connections_.clear();
+      for (auto &conn : newConnections) {
+        module->connect(conn);
+      }
     }
 
-    module->connections_.clear();
-    for (auto conn : newConnections) {
-      module->connect(conn);
+    if (unused_wires) {
+      // Remove unused wires
+      if (debug) {
+        log("Removing unused wires\n");
+        log_flush();
+      }
+      // TODO: This impacts equiv_opt ability to perform equivalence checking
+      pool<RTLIL::Wire *> wiresToRemove;
+      for (auto wire : module->wires()) {
+        if (wire->port_id) {
+          continue;
+        }
+        if (wire->get_bool_attribute(ID::keep))
+          continue;
+        bool bitVisited = false;
+        for (auto bit : SigSpec(wire)) {
+          if (is_observable(bit)) {
+            bitVisited = true;
+            break;
+          }
+        }
+        if (bitVisited)
+          continue;
+        wiresToRemove.insert(wire);
+      }
+
+      module->remove(wiresToRemove);
     }
-  }
 
-  if (unused_wires) {
-    // Remove unused wires
+    // Remove unused cells
     if (debug) {
-      log("Removing unused wires\n");
+      log("Removing unused cells\n");
       log_flush();
     }
-    // TODO: This impacts equiv_opt ability to perform equivalence checking
-    pool<RTLIL::Wire *> wiresToRemove;
-    for (auto wire : module->wires()) {
-      RTLIL::SigSpec sig = wire;
-      if (visitedSigSpec.count(sigmap(sig))) {
+    for (int c = 0; c < GetSize(cells); c++) {
+      Cell *cell = cells[c];
+      if (observable_cell[c] || cell->has_keep_attr()) {
         continue;
       }
-      bool bitVisited = false;
-      for (int i = 0; i < sig.size(); i++) {
-        SigSpec bit_sig = sig.extract(i, 1);
-        if (visitedSigSpec.count(bit_sig)) {
-          bitVisited = true;
-          break;
-        }
-      }
-      if (bitVisited)
-        continue;
-      if (wire->port_id) {
-        continue;
-      }
-      if (wire->get_bool_attribute(ID::keep))
-        continue;
-      wiresToRemove.insert(wire);
+      cells2rm[cell->type]++;
+      module->remove(cell);
     }
-
-    module->remove(wiresToRemove);
   }
 
-  // Remove unused cells
-  if (debug) {
-    log("Removing unused cells\n");
-    log_flush();
-  }
-  std::set<Cell *> cellsToRemove;
-  for (auto cell : module->cells()) {
-    if (visitedCells.count(cell)) {
-      continue;
-    }
-    if (cell->has_keep_attr())
-      continue;
-    cellsToRemove.insert(cell);
-  }
+  // ---------------------
+  // run
+  // ---------------------
+  void run(bool unused_wires, bool unused_assigns,
+           dict<RTLIL::IdString, int> &cells2rm) {
+    if (module->get_bool_attribute(ID::keep))
+      return;
 
-  for (auto cell : cellsToRemove) {
-    if (cells2rm.find(cell->type) != cells2rm.end()) {
-      cells2rm[cell->type]++;
-    } else {
-      cells2rm[cell->type] = 1;
+    if (!build()) {
+      return;
     }
-    module->remove(cell);
+
+    mark_observable();
+
+    clean(unused_wires, unused_assigns, cells2rm);
   }
-}
+};
 
 struct ObsClean : public ScriptPass {
   ObsClean() : ScriptPass("obs_clean", "Observability-based cleanup") {}
@@ -355,26 +371,8 @@ struct ObsClean : public ScriptPass {
         log("Processing module: %s\n", module->name.c_str());
         log_flush();
       }
-      SigMap sigmap(module);
-      // Precompute cell output sigspec to cell map
-      if (debug) {
-        log("Collecting cell info\n");
-        log_flush();
-      }
-      dict<RTLIL::SigSpec, std::set<Cell *>> sig2CellsInFanin;
-      dict<RTLIL::SigSpec, std::set<Cell *>> sig2CellsInFanout;
-      sigCellDrivers(module, sigmap, sig2CellsInFanout, sig2CellsInFanin);
-      // Precompute lhs2rhs and rhs2lhs sigspec map
-      if (debug) {
-        log("Collecting assign info\n");
-        log_flush();
-      }
-      dict<RTLIL::SigSpec, RTLIL::SigSpec> lhsSig2RhsSig;
-      dict<RTLIL::SigSpec, std::set<RTLIL::SigSpec>> rhsSig2LhsSig;
-      lhs2rhs_rhs2lhs(module, sigmap, rhsSig2LhsSig, lhsSig2RhsSig);
-      // Actual cleanup
-      observabilityClean(module, sigmap, sig2CellsInFanin, lhsSig2RhsSig,
-                         unused_wires, unused_assigns, debug, cells2rm);
+      ObsCleanWorker worker(module, debug);
+      worker.run(unused_wires, unused_assigns, cells2rm);
     }
     for (auto cell : cells2rm) {
       log("      o Removed %d '%s' cells\n", cell.second, log_id(cell.first));
@@ -16,6 +16,7 @@
  *
  */
 
+#include "design_stats.h"
 #include "kernel/celltypes.h"
 #include "kernel/log.h"
 #include "kernel/register.h"
@@ -35,6 +36,7 @@ struct ReportStatPass : public ScriptPass {
   RTLIL::Design *G_design = NULL;
   string csv_stat_file;
   bool dot;
+  bool verbose;
 
   // Methods
   //
@@ -43,412 +45,34 @@ struct ReportStatPass : public ScriptPass {
                    "Dump flattened netlist stats in file 'stat.csv'") {}
 
   // -------------------------
-  // getNumberOfDffs
+  // getNumberOfLuts
   // -------------------------
+  // LUTs, DFFs, DSPs and BRAMs of the known architectures are classified in
+  // 'design_stats.cc'.
+  //
   int getNumberOfLuts() {
-
-    int nb = 0;
-
-    for (auto cell : G_design->top_module()->cells()) {
-
-      // Generic Luts like for Zero Asic Z1000
-      //
-      if (cell->type.in(ID($lut))) {
-        nb++;
-        continue;
-      }
-
-      // Xilinx 'xc4v' Luts
-      //
-      if (cell->type.in(ID(LUT1), ID(LUT2), ID(LUT3), ID(LUT4), ID(INV))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(MUXF5), ID(MUXF6), ID(MUXF7))) {
-        nb++;
-        continue;
-      }
-
-      // Xilinx 'xc7' Luts
-      //
-      if (cell->type.in(ID(LUT1), ID(LUT2), ID(LUT3), ID(LUT4), ID(LUT5),
-                        ID(LUT6), ID(INV))) {
-        nb++;
-        continue;
-      }
-
-      // Lattice 'Mach xo2' Luts
-      //
-      if (cell->type.in(ID(LUT1), ID(LUT2), ID(LUT3), ID(LUT4))) {
-        nb++;
-        continue;
-      }
-
-      // ice40 'hx' Luts, carry cells
-      //
-      if (cell->type.in(ID(SB_LUT4))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(SB_CARRY))) {
-        nb++;
-        continue;
-      }
-
-      // Quicklogic 'pp3' Luts
-      //
-      if (cell->type.in(ID(LUT1), ID(LUT2), ID(LUT3), ID(LUT4))) {
-        nb++;
-        continue;
-      }
-
-      // Quicklogic 'pp3' mux4x0
-      //
-      if (cell->type.in(ID(mux4x0))) {
-        nb += 3; // equivalent to 3 LUT3 (Mux)
-        continue;
-      }
-
-      // Quicklogic 'pp3' mux8x0
-      //
-      if (cell->type.in(ID(mux8x0))) {
-        nb += 7; // equivalent to 7 LUT3 (Mux)
-        continue;
-      }
-
-      // Microchip 'polarfire' Luts
-      //
-      if (cell->type.in(ID(CFG1), ID(CFG2), ID(CFG3), ID(CFG4))) {
-        nb++;
-        continue;
-      }
-
-      // Intel 'cycloneiv' Luts
-      //
-      if (cell->type.in(ID($not), ID(cycloneiv_lcell_comb))) {
-        nb++;
-        continue;
-      }
-    }
-
-    return nb;
+    return DesignStats::get(G_design)->nb_luts(G_design->top_module());
   }
 
   // -------------------------
   // getNumberOfDffs
   // -------------------------
   int getNumberOfDffs() {
-
-    int nb = 0;
-
-    for (auto cell : G_design->top_module()->cells()) {
-
-      // Zero Asic Z1000/Z1010 DFFs
-      //
-      if (cell->type.in(ID(dffer), ID(dffes), ID(dffe), ID(dffr), ID(dffs),
-                        ID(dff))) {
-        nb++;
-      }
-
-      if (cell->type.in(ID(dffh), ID(dffeh), ID(dffl), ID(dffel), ID(dffhl),
-                        ID(dffehl))) {
-        nb++;
-      }
-
-      // Xilinx 'xc4v' DFFs, 'xc7'
-      //
-      if (cell->type.in(ID(FDCE), ID(FDPE), ID(FDRE), ID(FDRE_1), ID(FDSE),
-                        ID(LDCE))) { // LATCH !!!
-        nb++;
-        continue;
-      }
-
-      // Lattice 'Mach ox2' DFFs
-      //
-      if (cell->type.in(ID(TRELLIS_FF))) {
-        nb++;
-        continue;
-      }
-
-      // ice40 'hx' DFFs
-      //
-      if (cell->type.in(ID(SB_DFF), ID(SB_DFFE), ID(SB_DFFER), ID(SB_DFFESR),
-                        ID(SB_DFFESS), ID(SB_DFFN), ID(SB_DFFR), ID(SB_DFFS),
-                        ID(SB_DFFSR), ID(SB_DFFES))) {
-        nb++;
-        continue;
-      }
-
-      // Quicklogic 'pp3' DFFs
-      //
-      if (cell->type.in(ID(dffepc))) {
-        nb++;
-        continue;
-      }
-
-      // Microchip 'polarfire' Luts
-      //
-      if (cell->type.in(ID(SLE))) {
-        nb++;
-        continue;
-      }
-
-      // Intel 'cycloneiv' DFFs
-      //
-      if (cell->type.in(ID(dffeas))) {
-        nb++;
-        continue;
-      }
-
-      // rest of the world
-      //
-      if (cell->type.in(ID(dffer_pxp))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(dffes_xpp))) {
-        nb++;
-        continue;
-      }
-
-      if ((cell->type).substr(0, 5) == "$_DFF") {
-        nb++;
-        continue;
-      }
-
-      if ((cell->type).substr(0, 6) == "$_SDFF") {
-        nb++;
-        continue;
-      }
-    }
-
-    return nb;
+    return DesignStats::get(G_design)->nb_dffs(G_design->top_module());
   }
 
   // -------------------------
   // getNumberOfDSPs
   // -------------------------
   int getNumberOfDSPs() {
-
-    int nb = 0;
-
-    for (auto cell : G_design->top_module()->cells()) {
-
-      // Xilinx xc4v
-      //
-      if (cell->type.in(ID(DSP48))) {
-        nb++;
-        continue;
-      }
-
-      // Xilinx xc5v
-      //
-      if (cell->type.in(ID(DSP48E))) {
-        nb++;
-        continue;
-      }
-
-      if (cell->type.in(ID(DSP48E1))) {
-        nb++;
-        continue;
-      }
-
-      // Ice40
-      //
-      if (cell->type.in(ID(SB_MAC16))) {
-        nb++;
-        continue;
-      }
-
-      // Microchip
-      //
-      if (cell->type.in(ID(MACC_PA))) {
-        nb++;
-        continue;
-      }
-
-      // ZeroAsic
-      //
-      // Make sure it is in sync. with file under :
-      //    wildebeest/architecture/z1010/dsp/zeroasic_dsp_map_mode.v
-      //
-      // OR for instance
-      //
-      //    architecture/z1010/models/tech_mae.v
-      //
-      if (cell->type.in(ID(efpga_adder))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_adder_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_adder_rego))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_adder_regio))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_acc_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_acc))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_rego))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_regio))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_addc_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_addc_rego))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_addc_regio))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_mult_addc))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_macc_pipe))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_macc_pipe_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_macc_regi))) {
-        nb++;
-        continue;
-      }
-      if (cell->type.in(ID(efpga_macc))) {
-        nb++;
-        continue;
-      }
-    }
-
-    return nb;
+    return DesignStats::get(G_design)->nb_dsps(G_design->top_module());
   }
 
   // -------------------------
   // getNumberOfBRAMs
   // -------------------------
   int getNumberOfBRAMs() {
-
-    int nb = 0;
-
-    for (auto cell : G_design->top_module()->cells()) {
-
-      // Xilinx xc4v
-      //
-      if (cell->type.in(ID(RAMB16))) {
-        nb++;
-        continue;
-      }
-
-      // Xilinx xc7
-      //
-      if (cell->type.in(ID(RAM32M))) {
-        nb++;
-        continue;
-      }
-
-      // Ice40
-      //
-      if (cell->type.in(ID(SB_RAM40_4K))) {
-        nb++;
-        continue;
-      }
-
-      // Lattice xo2
-      //
-      if (cell->type.in(ID(DP8KC))) {
-        nb++;
-        continue;
-      }
-
-      // Intel cycloneiv
-      //
-      if (cell->type.in(ID(altsyncram))) {
-        nb++;
-        continue;
-      }
-
-      // Microchip polarfire
-      //
-      if (cell->type.in(ID(RAM1K20))) {
-        nb++;
-        continue;
-      }
-
-      // Zeroasic
-      //
-      if (cell->type.in(
-              // New Peter's RAM coming from :
-              //      architecture/z1010/bram/techmap.v
-              //
-              // sprams
-              //
-              ID(spram_512x32), ID(spram_1024x16), ID(spram_2048x8),
-              ID(spram_4096x4), ID(spram_8192x2), ID(spram_16384x1),
-
-              // sdprams
-              //
-              ID(sdpram_1024x16), ID(sdpram_2048x8), ID(sdpram_4096x4),
-              ID(sdpram_8192x2), ID(sdpram_16384x1), ID(sdpram_16384x1),
-
-              // tdprams
-              //
-              ID(tdpram_1024x16), ID(tdpram_2048x8), ID(tdpram_4096x4),
-              ID(tdpram_8192x2), ID(tdpram_16384x1),
-
-              // Old RAM names
-              //
-              ID(spram_512x64), ID(spram_1024x32), ID(spram_2048x16),
-              ID(spram_4096x8), ID(spram_8192x4), ID(spram_16384x2),
-              ID(spram_32768x1),
-
-              ID(sdpram_1024x32), ID(sdpram_2048x16), ID(sdpram_4096x8),
-              ID(sdpram_8192x4), ID(sdpram_16384x2), ID(sdpram_32768x1),
-
-              ID(tdpram_1024x32), ID(tdpram_2048x16), ID(tdpram_4096x8),
-              ID(tdpram_8192x4), ID(tdpram_16384x2), ID(tdpram_32768x1))) {
-        nb++;
-        continue;
-      }
-
-      // rest of the world
-      //
-      if (cell->type.in(ID(RAM64x12))) {
-        nb++;
-        continue;
-      }
-    }
-
-    return nb;
+    return DesignStats::get(G_design)->nb_brams(G_design->top_module());
   }
 
   // -------------------------
@@ -464,11 +88,16 @@ struct ReportStatPass : public ScriptPass {
     log("        write design statistics into a CSV file. Default file name\n");
     log("        is 'stat.csv'.\n");
     log("\n");
+    log("    -verbose\n");
+    log("        print the full 'stat' report instead of the summary of the\n");
+    log("        incrementally maintained design stats.\n");
+    log("\n");
   }
 
   void clear_flags() override {
     csv_stat_file = "stat.csv";
     dot = false;
+    verbose = false;
   }
 
   void execute(std::vector<std::string> args, RTLIL::Design *design) override {
@@ -487,6 +116,10 @@ struct ReportStatPass : public ScriptPass {
         dot = true;
         continue;
       }
+      if (args[argidx] == "-verbose") {
+        verbose = true;
+        continue;
+      }
     }
     extra_args(args, argidx, design);
 
@@ -591,7 +224,11 @@ struct ReportStatPass : public ScriptPass {
 
     log("\n   Dumped file %s\n", csv_stat_file.c_str());
 
-    run("stat");
+    if (verbose) {
+      run("stat");
+    } else {
+      DesignStats::get(G_design)->log_summary(topModule, true /* types */);
+    }
 
   } // end script()
 
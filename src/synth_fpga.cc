@@ -26,14 +26,25 @@
 #include "kernel/rtlil.h"
 #include "kernel/sigtools.h"
 #include "kernel/yosys.h"
+#include "backends/rtlil/rtlil_backend.h"
+#include "design_stats.h"
+#include "cell_library.h"
+#include "zjobs.h"
 #include "version.h"
 #include "synth_fpga_version.h"
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 #include <chrono>
 #include <filesystem>
+#include <thread>
+#include <sys/resource.h>
 #include <unistd.h>
 
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
 #define HUGE_NB_CELLS 5000000 // 5 Million cells
 #define BIG_NB_CELLS 500000   // 500K cells
 #define SMALL_NB_CELLS 250000 // 250K cells
@@ -49,6 +60,7 @@ struct SynthFpgaPass : public ScriptPass {
   string abc_script_version;
   bool no_flatten, dff_enable, dff_async_set, dff_async_reset;
   bool obs_clean, wait, show_max_level, csv, insbuf, resynthesis, autoname;
+  bool verbose;
   bool no_opt_sat_dff, show_config, stop_if_undriven_nets;
   bool no_xor_tree_process;
   bool no_opt_const_dff;
@@ -66,12 +78,35 @@ struct SynthFpgaPass : public ScriptPass {
   bool no_sdff;
   string dsp_tech;
   string bram_tech;
+  string trace_file;
+  int abc_jobs;
+  string abc_cache_dir;
+  int abc_cache_size;
+  string abc_portfolio;
+  double abc_portfolio_timeout;
+  double abc_timeout;
+  double abc_step_timeout;
+  double time_budget;
+  int hier_jobs;
+  string hier_options;
+  pool<IdString> model_modules;
+  bool model_modules_known;
+  string checkpoint_dir;
+  string checkpoint_options;
+  string checkpoint_key;
+  string current_stage;
 
   pool<string> opt_options = {"fast", "area", "delay"};
   pool<string> partnames = {"z1000", "z1010", "z1060"};
   pool<string> dsp_arch = {"config", "zeroasic", "bare_mult", "mae"};
   pool<string> bram_arch = {"config", "zeroasic"};
 
+  // Labelled stages of the flow, in execution order (see '-run' option).
+  //
+  vector<string> flow_stages = {"begin", "coarse",  "dsp",
+                                "bram",  "dff_opt", "legalize",
+                                "abc",   "cleanup", "report"};
+
   typedef enum e_dff_init_value { S0, S1, SX, SK } dff_init_value;
 
   // ----------------------------
@@ -102,252 +137,6 @@ struct SynthFpgaPass : public ScriptPass {
   //
   SynthFpgaPass() : ScriptPass("synth_fpga", "Zero Asic FPGA synthesis flow") {}
 
-  // -------------------------
-  // Json reader
-  // -------------------------
-  // Json node that stores sections of the synthesis 'config' file.
-  //
-  struct JsonNode {
-    char type; // S=String, N=Number, A=Array, D=Dict
-    string data_string;
-    int64_t data_number;
-    vector<JsonNode *> data_array;
-    dict<string, JsonNode *> data_dict;
-    vector<string> data_dict_keys;
-
-    JsonNode(std::istream &f, string &cf_file, int &line) {
-      type = 0;
-      data_number = 0;
-
-      while (1) {
-        int ch = f.get();
-
-        if (ch == EOF)
-          log_error("Unexpected EOF in JSON file.\n");
-
-        if (ch == '\n')
-          line++;
-        if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n')
-          continue;
-
-        if (ch == '"') {
-          type = 'S';
-
-          while (1) {
-            ch = f.get();
-
-            if (ch == EOF)
-              log_error("Unexpected EOF in JSON string.\n");
-
-            if (ch == '"')
-              break;
-
-            if (ch == '\\') {
-              ch = f.get();
-
-              switch (ch) {
-              case EOF:
-                log_error("Unexpected EOF in JSON string.\n");
-                break;
-              case '"':
-              case '/':
-              case '\\':
-                break;
-              case 'b':
-                ch = '\b';
-                break;
-              case 'f':
-                ch = '\f';
-                break;
-              case 'n':
-                ch = '\n';
-                break;
-              case 'r':
-                ch = '\r';
-                break;
-              case 't':
-                ch = '\t';
-                break;
-              case 'u':
-                int val = 0;
-                for (int i = 0; i < 4; i++) {
-                  ch = f.get();
-                  val <<= 4;
-                  if (ch >= '0' && '9' >= ch) {
-                    val += ch - '0';
-                  } else if (ch >= 'A' && 'F' >= ch) {
-                    val += 10 + ch - 'A';
-                  } else if (ch >= 'a' && 'f' >= ch) {
-                    val += 10 + ch - 'a';
-                  } else
-                    log_error("Unexpected non-digit character in \\uXXXX "
-                              "sequence: %c at line %d.\n",
-                              ch, line);
-                }
-                if (val < 128)
-                  ch = val;
-                else
-                  log_error("Unsupported \\uXXXX sequence in JSON string: %04X "
-                            "at line %d.\n",
-                            val, line);
-                break;
-              }
-            }
-
-            data_string += ch;
-          }
-
-          break;
-        }
-
-        if (('0' <= ch && ch <= '9') || ch == '-') {
-          bool negative = false;
-          type = 'N';
-          if (ch == '-') {
-            data_number = 0;
-            negative = true;
-          } else {
-            data_number = ch - '0';
-          }
-
-          data_string += ch;
-
-          while (1) {
-            ch = f.get();
-
-            if (ch == EOF)
-              break;
-
-            if (ch == '.')
-              goto parse_real;
-
-            if (ch < '0' || '9' < ch) {
-              f.unget();
-              break;
-            }
-
-            data_number = data_number * 10 + (ch - '0');
-            data_string += ch;
-          }
-
-          data_number = negative ? -data_number : data_number;
-          data_string = "";
-          break;
-
-        parse_real:
-          type = 'S';
-          data_number = 0;
-          data_string += ch;
-
-          while (1) {
-            ch = f.get();
-
-            if (ch == EOF)
-              break;
-
-            if (ch < '0' || '9' < ch) {
-              f.unget();
-              break;
-            }
-
-            data_string += ch;
-          }
-
-          break;
-        }
-
-        if (ch == '[') {
-          type = 'A';
-
-          while (1) {
-            ch = f.get();
-
-            if (ch == EOF)
-              log_error("Unexpected EOF in JSON file '%s'.\n", cf_file.c_str());
-
-            if (ch == '\n')
-              line++;
-
-            if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
-                ch == ',')
-              continue;
-
-            if (ch == ']')
-              break;
-
-            f.unget();
-            data_array.push_back(new JsonNode(f, cf_file, line));
-          }
-
-          break;
-        }
-
-        if (ch == '{') {
-          type = 'D';
-
-          while (1) {
-            ch = f.get();
-
-            if (ch == EOF)
-              log_error("Unexpected EOF in JSON file '%s'.\n", cf_file.c_str());
-
-            if (ch == '\n')
-              line++;
-
-            if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
-                ch == ',')
-              continue;
-
-            if (ch == '}')
-              break;
-
-            f.unget();
-            JsonNode key(f, cf_file, line);
-
-            while (1) {
-              ch = f.get();
-
-              if (ch == EOF)
-                log_error("Unexpected EOF in JSON file '%s'.\n",
-                          cf_file.c_str());
-
-              if (ch == '\n')
-                line++;
-
-              if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' ||
-                  ch == ':')
-                continue;
-
-              f.unget();
-              break;
-            }
-
-            JsonNode *value = new JsonNode(f, cf_file, line);
-
-            if (key.type != 'S')
-              log_error("Unexpected non-string key in JSON dict at line %d.\n",
-                        line);
-
-            data_dict[key.data_string] = value;
-            data_dict_keys.push_back(key.data_string);
-          }
-
-          break;
-        }
-
-        log_error("Unexpected character '%c' in config file '%s' at line %d.\n",
-                  ch, cf_file.c_str(), line);
-      }
-    }
-
-    ~JsonNode() {
-      for (auto it : data_array)
-        delete it;
-      for (auto &it : data_dict)
-        delete it.second;
-    }
-  };
-
   // -------------------------
   // Example of config file
   // -------------------------
@@ -415,6 +204,10 @@ struct SynthFpgaPass : public ScriptPass {
     dict<string, string> dsps_parameter_string;
     string dsps_pack_command;
 
+    // Timing related : the 'timing' section is read by 'max_level -delays'.
+    //
+    bool has_timing;
+
   } config_type;
 
   // The global config object
@@ -497,6 +290,8 @@ struct SynthFpgaPass : public ScriptPass {
     log("\n");
     log("  DSP pack_command   : \n");
     log("                       %s\n", (G_config.dsps_pack_command).c_str());
+    log("\n");
+    log("  timing             : %s\n", G_config.has_timing ? "yes" : "no");
 
     log(" ====================================================================="
         "=====\n");
@@ -859,6 +654,10 @@ struct SynthFpgaPass : public ScriptPass {
   //
   void read_config() {
 
+    // The cell types added by the config of a previous run are dropped.
+    //
+    CellLibrary::get().reset();
+
     // if no 'config_file' specified return right away
     //
     if (config_file == "") {
@@ -972,9 +771,27 @@ struct SynthFpgaPass : public ScriptPass {
       }
     }
 
+    // timing (optional)
+    //
+    JsonNode *timing = NULL;
+    if (root.data_dict.count("timing") != 0) {
+      timing = root.data_dict.at("timing");
+      if (timing->type != 'D') {
+        log_error("'timing' must be a dictionnary.\n");
+      }
+    }
+
+    // cells (optional) : technology cell types added to the built-in ones
+    // of the 'CellLibrary'.
+    //
+    if (root.data_dict.count("cells") != 0) {
+      CellLibrary::get().read_config(root.data_dict.at("cells"), config_file);
+    }
+
     // Extract data and fill up 'G_config'
     //
     G_config.config_file = config_file;
+    G_config.has_timing = (timing != NULL);
 
     G_config.version = version->data_number;
 
@@ -1754,7 +1571,7 @@ struct SynthFpgaPass : public ScriptPass {
 
     log_header(yosys_get_design(), "Analyze XOR trees\n");
 
-    run("stat");
+    show_stat();
 
 #if 0
     run(stringf("write_verilog -norename -noexpr -nohex -nodec before_binary_decomp_xor_trees.verilog"));
@@ -1973,7 +1790,7 @@ struct SynthFpgaPass : public ScriptPass {
 
     log("Found '%d' duplicated XORs after binarization.\n", nb_duplicate);
 
-    run("stat");
+    show_stat();
 
 #if 0
     run(stringf("write_blif after_binary_decomp_xor_trees.blif"));
@@ -2241,7 +2058,7 @@ struct SynthFpgaPass : public ScriptPass {
     //
     if (!no_opt_sat_dff) {
 
-      run("stat");
+      show_stat();
 
       if (!no_opt_const_dff) {
         run("zopt_const_dff");
@@ -2388,21 +2205,15 @@ struct SynthFpgaPass : public ScriptPass {
   //
   int getNumberOfLuts() {
 
-    int nb = 0;
-
     if (!yosys_get_design()) {
       log_warning("Design seems empty ! (did you define the -top or use "
                   "'hierarchy -auto-top' before)\n");
       return -1;
     }
 
-    for (auto cell : yosys_get_design()->top_module()->cells()) {
-      if (cell->type.in(ID($lut))) {
-        nb++;
-      }
-    }
+    Design *design = yosys_get_design();
 
-    return nb;
+    return DesignStats::get(design)->nb_luts(design->top_module());
   }
 
   // -------------------------
@@ -2411,28 +2222,15 @@ struct SynthFpgaPass : public ScriptPass {
   //
   int getNumberOfDffs() {
 
-    int nb = 0;
-
     if (!yosys_get_design()) {
       log_warning("Design seems empty ! (did you define the -top or use "
                   "'hierarchy -auto-top' before)\n");
       return -1;
     }
 
-    for (auto cell : yosys_get_design()->top_module()->cells()) {
-
-      if (cell->type.in(ID(dffer), ID(dffes), ID(dffe), ID(dffr), ID(dffs),
-                        ID(dff))) {
-        nb++;
-      }
-
-      if (cell->type.in(ID(dffh), ID(dffeh), ID(dffl), ID(dffel), ID(dffhl),
-                        ID(dffehl))) {
-        nb++;
-      }
-    }
+    Design *design = yosys_get_design();
 
-    return nb;
+    return DesignStats::get(design)->nb_dffs(design->top_module());
   }
 
   // -------------------------
@@ -2586,145 +2384,1846 @@ struct SynthFpgaPass : public ScriptPass {
   // -------------------------
   //
   int getNumberOfCells() {
-    return ((yosys_get_design()->top_module()->cells()).size());
+    Design *design = yosys_get_design();
+
+    return DesignStats::get(design)->nb_cells(design->top_module());
   }
 
   // -------------------------
-  // clean_design
+  // recount_stats
   // -------------------------
+  // 'flatten' copies the cells of the sub modules without notifying the
+  // design stats : they are recounted from scratch.
   //
-  void clean_design() {
-    if (obs_clean) {
+  void recount_stats() {
+    if (help_mode) {
+      return;
+    }
 
-      run("splitcells");
+    DesignStats::get(yosys_get_design())->recount_design();
+  }
 
-      run("splitnets");
+  // -------------------------
+  // show_stat
+  // -------------------------
+  // Summary of the incrementally maintained design stats. The full 'stat'
+  // report walks the whole design so it is only run with '-verbose'.
+  //
+  void show_stat(bool show_types = false) {
+    if (verbose || help_mode) {
+      run("stat");
+      return;
+    }
 
-      // This is usefull to get non-LUT cells IOs directions to allow
-      // the 'obs_clean' traversal to correctly operate.
-      //
-      load_bb_cells_models();
+    Design *design = yosys_get_design();
 
-      run("obs_clean");
+    DesignStats::get(design)->log_summary(design->top_module(), show_types);
+  }
 
-      run("hierarchy");
+  // ---------------------------------------
+  // Flow tracing (-trace option)
+  // ---------------------------------------
+  // One record per 'run()' call of the flow.
+  //
+  typedef struct {
+    string command;
+    string stage;
+    double start_sec; // offset from the start of the flow
+    double wall_sec;
+    double cpu_sec;         // yosys + ABC sub-processes
+    long peak_rss_delta_kb; // growth of the yosys peak RSS
+    long child_peak_rss_kb; // peak RSS of the biggest sub-process so far
+    int cells_before;
+    int cells_after;
+  } trace_event;
+
+  vector<trace_event> trace_events;
+  std::chrono::high_resolution_clock::time_point trace_start_time;
 
-      run("stat");
+  // -------------------------
+  // getDesignNumberOfCells
+  // -------------------------
+  // Cell count of all the modules, e.g also before 'flatten'.
+  //
+  int getDesignNumberOfCells() {
+    if (!yosys_get_design()) {
+      return 0;
+    }
 
-    } else {
+    return DesignStats::get(yosys_get_design())->nb_design_cells();
+  }
 
-      run("opt_clean");
-    }
+  // -------------------------
+  // get_cpu_time
+  // -------------------------
+  // CPU time (user + system) of yosys and of its terminated sub-processes
+  // (ex: 'yosys-abc').
+  //
+  static double get_cpu_time() {
+    struct rusage self, children;
+
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+
+    double cpu = 0;
+    cpu += self.ru_utime.tv_sec + self.ru_utime.tv_usec * 1e-6;
+    cpu += self.ru_stime.tv_sec + self.ru_stime.tv_usec * 1e-6;
+    cpu += children.ru_utime.tv_sec + children.ru_utime.tv_usec * 1e-6;
+    cpu += children.ru_stime.tv_sec + children.ru_stime.tv_usec * 1e-6;
+
+    return cpu;
   }
 
   // -------------------------
-  // abc_synthesize
+  // get_peak_rss_kb
   // -------------------------
   //
-  void abc_synthesize() {
-    if (!yosys_get_design()) {
-      log_warning("Design seems empty ! (did you define the -top or use "
-                  "'hierarchy -auto-top' before)\n");
-      return;
-    }
+  static long get_peak_rss_kb(int who) {
+    struct rusage usage;
 
-    run("stat");
+    getrusage(who, &usage);
 
-    if (opt == "") {
-      log_header(yosys_get_design(),
-                 "Performing OFFICIAL PLATYPUS optimization\n");
-      run("abc -lut " + sc_syn_lut_size);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+  }
+
+  // -------------------------
+  // run
+  // -------------------------
+  // Wrapper on top of 'ScriptPass::run' so that each command of the flow is
+  // measured when '-trace' is used.
+  //
+  void run(string command, string info = string()) {
+    if (trace_file.empty() || help_mode) {
+      ScriptPass::run(command, info);
       return;
     }
 
-#if 0
-    run("show -prefix before_abc");
-#endif
+    trace_event event;
 
-    string mode = opt;
+    event.command = command;
+    event.stage = current_stage;
+    event.cells_before = getDesignNumberOfCells();
 
-    // Switch to FAST ABC synthesis script for huge designs in order to avoid
-    // runtime blow up.
-    //
-    // ex: 'ifu', 'l2c', 'e203' designs will be impacted with sometime slight
-    // max level degradation but with nice speed-up (ex: 'e203' from 5000 sec.
-    // downto 1400 sec.)
-    //
-    int nb_cells = getNumberOfCells();
+    long rss_before = get_peak_rss_kb(RUSAGE_SELF);
+    double cpu_before = get_cpu_time();
+    auto startTime = std::chrono::high_resolution_clock::now();
 
-    if (nb_cells <= TINY_NB_CELLS) {
+    ScriptPass::run(command, info);
 
-      if ((mode == "area") || (abc_script_version == "BASIC")) {
+    auto endTime = std::chrono::high_resolution_clock::now();
 
-        mode = "tiny_area";
+    event.start_sec = std::chrono::duration<double>(startTime -
+                                                    trace_start_time)
+                          .count();
+    event.wall_sec = std::chrono::duration<double>(endTime - startTime).count();
+    event.cpu_sec = get_cpu_time() - cpu_before;
+    event.peak_rss_delta_kb = get_peak_rss_kb(RUSAGE_SELF) - rss_before;
+    event.child_peak_rss_kb = get_peak_rss_kb(RUSAGE_CHILDREN);
+    event.cells_after = getDesignNumberOfCells();
 
-      } else if (mode == "delay") {
+    trace_events.push_back(event);
+  }
 
-        mode = "tiny_delay";
+  // -------------------------
+  // json_escape
+  // -------------------------
+  //
+  static string json_escape(const string &s) {
+    string res;
+
+    for (char ch : s) {
+      if (ch == '"' || ch == '\\') {
+        res += '\\';
+        res += ch;
+        continue;
+      }
+      if (ch == '\n') {
+        res += "\\n";
+        continue;
+      }
+      if (ch == '\t') {
+        res += "\\t";
+        continue;
       }
+      res += ch;
+    }
 
-    } else if (nb_cells <= SMALL_NB_CELLS) {
+    return res;
+  }
 
-      if ((mode == "area") || (abc_script_version == "BASIC")) {
+  // -------------------------
+  // dump_trace_file
+  // -------------------------
+  // Dump the flow commands as Chrome trace events ('chrome://tracing' or
+  // 'ui.perfetto.dev' can load it).
+  //
+  void dump_trace_file() {
+    std::ofstream trace(trace_file);
 
-        mode = "small_area";
+    if (!trace.is_open()) {
+      log_warning("Cannot open trace file '%s'.\n", trace_file.c_str());
+      return;
+    }
 
-      } else if (mode == "delay") {
+    trace << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
 
-        mode = "small_delay";
-      }
+    for (size_t i = 0; i < trace_events.size(); i++) {
 
-    } else if (nb_cells >=
-               HUGE_NB_CELLS) { // example : 'zmcml' from Golden suite
+      const trace_event &event = trace_events[i];
 
-      mode = "huge";
+      trace << stringf("  {\"name\": \"%s\", \"cat\": \"%s\", "
+                       "\"ph\": \"X\", \"pid\": 1, \"tid\": 1, "
+                       "\"ts\": %.0f, \"dur\": %.0f, \"args\": {"
+                       "\"cpu_sec\": %.3f, \"peak_rss_delta_kb\": %ld, "
+                       "\"child_peak_rss_kb\": %ld, \"cells_before\": %d, "
+                       "\"cells_after\": %d}}",
+                       json_escape(event.command).c_str(),
+                       event.stage.empty() ? "synth_fpga" : event.stage.c_str(),
+                       event.start_sec * 1e6, event.wall_sec * 1e6,
+                       event.cpu_sec, event.peak_rss_delta_kb,
+                       event.child_peak_rss_kb, event.cells_before,
+                       event.cells_after);
 
-      log_warning("Optimization script changed from '%s' to '%s' due to design "
-                  "size (%d cells)\n",
-                  opt.c_str(), mode.c_str(), nb_cells);
+      trace << ((i + 1 < trace_events.size()) ? ",\n" : "\n");
+    }
 
-    } else if (nb_cells >=
-               BIG_NB_CELLS) { // example : 'e203_soc_top' from Golden suite
+    trace << "]}\n";
+    trace.close();
 
-      if (mode == "delay") {
+    log("\n   Dumped trace file %s\n", trace_file.c_str());
+  }
 
-        mode = "fast_delay";
+  // -------------------------
+  // show_trace_summary
+  // -------------------------
+  // Summary of the traced commands sorted by decreasing wall time. Commands
+  // are aggregated on their name (ex: all the 'opt_clean' calls).
+  //
+  void show_trace_summary() {
+    dict<string, trace_event> per_command;
+    dict<string, int> nb_calls;
 
-      } else {
+    for (auto &event : trace_events) {
 
-        mode = "fast_area";
+      string name = event.command.substr(0, event.command.find(' '));
+
+      if (per_command.count(name) == 0) {
+        per_command[name] = event;
+        per_command[name].cells_before = 0;
+        per_command[name].cells_after = 0;
+        nb_calls[name] = 1;
+      } else {
+        trace_event &agg = per_command[name];
+        agg.wall_sec += event.wall_sec;
+        agg.cpu_sec += event.cpu_sec;
+        agg.peak_rss_delta_kb += event.peak_rss_delta_kb;
+        nb_calls[name]++;
       }
 
-      log_warning("Optimization script changed from '%s' to '%s' due to design "
-                  "size (%d cells)\n",
-                  opt.c_str(), mode.c_str(), nb_cells);
+      per_command[name].cells_before += event.cells_before;
+      per_command[name].cells_after += event.cells_after;
     }
 
-    // Otherwise specific ABC script based flow
-    //
-    string abc_script = "+/plugins/wildebeest/abc_scripts/LUT" +
-                        sc_syn_lut_size + "/" + abc_script_version + "/" +
-                        mode + "_lut" + sc_syn_lut_size + ".scr";
+    vector<std::pair<string, trace_event>> sorted(per_command.begin(),
+                                                  per_command.end());
 
-    log_header(yosys_get_design(), "Calling ABC script in '%s' mode\n",
-               mode.c_str());
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<string, trace_event> &a,
+                 const std::pair<string, trace_event> &b) {
+                return a.second.wall_sec > b.second.wall_sec;
+              });
+
+    double total_wall = 0;
+    for (auto &it : sorted) {
+      total_wall += it.second.wall_sec;
+    }
+
+    log("\n");
+    log("   Synthesis trace summary (sorted by wall time)\n");
+    log("   ------------------------------------------------------------------"
+        "-------\n");
+    log("   %-20s %6s %10s %6s %10s %12s %10s\n", "command", "calls",
+        "wall (s)", "%", "cpu (s)", "peak RSS +KB", "cells +/-");
+    log("   ------------------------------------------------------------------"
+        "-------\n");
+
+    for (auto &it : sorted) {
+
+      const trace_event &agg = it.second;
 
-    run("abc -script " + abc_script);
+      log("   %-20s %6d %10.2f %6.1f %10.2f %12ld %10d\n", it.first.c_str(),
+          nb_calls[it.first], agg.wall_sec,
+          total_wall > 0 ? 100.0 * agg.wall_sec / total_wall : 0.0,
+          agg.cpu_sec, agg.peak_rss_delta_kb,
+          agg.cells_after - agg.cells_before);
+    }
+
+    log("   ------------------------------------------------------------------"
+        "-------\n");
+    log("   %-20s %6ld %10.2f\n", "total", trace_events.size(), total_wall);
   }
 
   // -------------------------
-  // legalize_flops
+  // end_trace
   // -------------------------
-  // Code picked up from procedure 'legalize_flops' in TCL
-  // 'sc_synth_fpga.tcl' (Thierry)
-  // DFF features considered so far :
-  //     - enable
-  //     - async_set
-  //     - async_reset
   //
-  void legalize_flops() {
-    string legalize_list = format_legal_flops();
-    run("dfflegalize" + legalize_list);
+  void end_trace() {
+    if (trace_file.empty() || help_mode) {
+      return;
+    }
+
+    show_trace_summary();
+
+    dump_trace_file();
+  }
+
+  // ---------------------------------------
+  // Flow checkpoints (-checkpoint_dir option)
+  // ---------------------------------------
+  // Each labelled stage dumps the design at its end in
+  // '<checkpoint_dir>/<key>/<stage>.il'. The key hashes the input design, the
+  // config file and the options so that '-run <from>:<to>' only restarts from
+  // a checkpoint computed on the very same input.
+  //
+
+  // -------------------------
+  // check_label
+  // -------------------------
+  // Wrapper on top of 'ScriptPass::check_label' to keep track of the current
+  // stage (used by '-trace').
+  //
+  bool check_label(string label, string info = string()) {
+    bool active = ScriptPass::check_label(label, info);
+
+    if (active) {
+      current_stage = label;
+    }
+
+    return active;
+  }
+
+  // -------------------------
+  // fnv1a_hash
+  // -------------------------
+  //
+  static uint64_t fnv1a_hash(const string &s,
+                             uint64_t hash = 0xcbf29ce484222325ULL) {
+    for (unsigned char ch : s) {
+      hash ^= ch;
+      hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+  }
+
+  // -------------------------
+  // compute_checkpoint_key
+  // -------------------------
+  //
+  string compute_checkpoint_key() {
+    uint64_t hash = fnv1a_hash(SYNTH_FPGA_VERSION);
+
+    hash = fnv1a_hash(checkpoint_options, hash);
+
+    if (!config_file.empty()) {
+      std::ifstream cfg(config_file);
+      std::stringstream content;
+      content << cfg.rdbuf();
+      hash = fnv1a_hash(content.str(), hash);
+    }
+
+    hash = hash_design(hash);
+
+    return stringf("%016llx", (unsigned long long)hash);
+  }
+
+  // -------------------------
+  // hash_design
+  // -------------------------
+  // Hash the canonical form of the modules, sorted by name (see
+  // 'canonical_module').
+  //
+  static uint64_t hash_design(uint64_t hash) {
+    Design *design = yosys_get_design();
+
+    vector<Module *> modules = design->modules();
+
+    std::sort(modules.begin(), modules.end(), [](Module *a, Module *b) {
+      return a->name.str() < b->name.str();
+    });
+
+    for (auto module : modules) {
+      hash = fnv1a_hash(canonical_module(module), hash);
+    }
+
+    return hash;
+  }
+
+  // -------------------------
+  // canonical_module
+  // -------------------------
+  // Text of 'module' that does not depend on the 'autoidx' numbering : the
+  // internal ('$...') wires and cells are renamed in the order they are
+  // reached from the public wires, and the attributes ('src', ...) are
+  // dropped except 'init' and 'keep'. Two runs of the flow on the same RTL
+  // give the same text.
+  //
+  static string canonical_module(Module *module) {
+    dict<Wire *, string> wire_ids;
+    dict<Cell *, string> cell_ids;
+    vector<Wire *> wires;
+    vector<Cell *> cells;
+
+    dict<Wire *, vector<Cell *>> wire_cells;
+
+    for (auto cell : module->cells()) {
+      for (auto &conn : cell->connections()) {
+        for (auto &chunk : conn.second.chunks()) {
+          if (chunk.wire) {
+            wire_cells[chunk.wire].push_back(cell);
+          }
+        }
+      }
+    }
+
+    auto add_wire = [&](Wire *wire) {
+      if (wire_ids.count(wire)) {
+        return;
+      }
+      wire_ids[wire] = wire->name.isPublic()
+                           ? wire->name.str()
+                           : stringf("$w%d", GetSize(wire_ids));
+      wires.push_back(wire);
+    };
+
+    // Seeds : the public wires, by name.
+    //
+    vector<Wire *> seeds;
+
+    for (auto wire : module->wires()) {
+      if (wire->name.isPublic()) {
+        seeds.push_back(wire);
+      }
+    }
+
+    std::sort(seeds.begin(), seeds.end(), [](Wire *a, Wire *b) {
+      return a->name.str() < b->name.str();
+    });
+
+    for (auto wire : seeds) {
+      add_wire(wire);
+    }
+
+    // Breadth first from the seeds, then from the wires and cells not
+    // reached, in module order. The cells on a wire are visited by type,
+    // then by the port they connect it to.
+    //
+    vector<Wire *> all_wires = module->wires();
+    vector<Cell *> all_cells = module->cells();
+    size_t next_wire = 0, next_cell = 0;
+
+    for (size_t w = 0; w < wires.size() || next_wire < all_wires.size() ||
+                       next_cell < all_cells.size();) {
+
+      if (w == wires.size()) {
+        if (next_wire < all_wires.size()) {
+          add_wire(all_wires[next_wire++]);
+          continue;
+        }
+
+        Cell *cell = all_cells[next_cell++];
+
+        if (!cell_ids.count(cell)) {
+          cell_ids[cell] = cell->name.isPublic()
+                               ? cell->name.str()
+                               : stringf("$c%d", GetSize(cell_ids));
+          cells.push_back(cell);
+        }
+        continue;
+      }
+
+      Wire *wire = wires[w++];
+
+      if (!wire_cells.count(wire)) {
+        continue;
+      }
+
+      vector<pair<string, Cell *>> next;
+
+      for (auto cell : wire_cells.at(wire)) {
+
+        if (cell_ids.count(cell)) {
+          continue;
+        }
+
+        string port;
+
+        for (auto &conn : cell->connections()) {
+          for (auto &chunk : conn.second.chunks()) {
+            if ((chunk.wire == wire) &&
+                (port.empty() || (conn.first.str() < port))) {
+              port = conn.first.str();
+            }
+          }
+        }
+
+        next.push_back({cell->type.str() + " " + port, cell});
+      }
+
+      std::stable_sort(next.begin(), next.end(),
+                       [](const pair<string, Cell *> &a,
+                          const pair<string, Cell *> &b) {
+                         return a.first < b.first;
+                       });
+
+      for (auto &it : next) {
+
+        Cell *cell = it.second;
+
+        if (cell_ids.count(cell)) {
+          continue;
+        }
+
+        cell_ids[cell] = cell->name.isPublic()
+                             ? cell->name.str()
+                             : stringf("$c%d", GetSize(cell_ids));
+        cells.push_back(cell);
+
+        vector<IdString> ports;
+
+        for (auto &conn : cell->connections()) {
+          ports.push_back(conn.first);
+        }
+
+        std::sort(ports.begin(), ports.end(), RTLIL::sort_by_id_str());
+
+        for (auto port : ports) {
+          for (auto &chunk : cell->getPort(port).chunks()) {
+            if (chunk.wire) {
+              add_wire(chunk.wire);
+            }
+          }
+        }
+      }
+    }
+
+    auto sig_str = [&](const SigSpec &sig) {
+      string str;
+
+      for (auto &chunk : sig.chunks()) {
+        if (chunk.wire) {
+          str += stringf(" %s[%d+%d]", wire_ids.at(chunk.wire).c_str(),
+                         chunk.offset, chunk.width);
+        } else {
+          str += " " + Const(chunk.data).as_string();
+        }
+      }
+
+      return str;
+    };
+
+    std::ostringstream text;
+
+    text << "module " << module->name.str() << "\n";
+
+    for (auto wire : wires) {
+      text << "wire " << wire_ids.at(wire) << " " << wire->width << " "
+           << wire->start_offset << " " << wire->upto << " " << wire->port_id
+           << " " << wire->port_input << " " << wire->port_output;
+
+      if (wire->attributes.count(ID::init)) {
+        text << " init " << wire->attributes.at(ID::init).as_string();
+      }
+
+      text << (wire->get_bool_attribute(ID::keep) ? " keep\n" : "\n");
+    }
+
+    for (auto cell : cells) {
+
+      text << "cell " << cell_ids.at(cell) << " " << cell->type.str()
+           << (cell->get_bool_attribute(ID::keep) ? " keep\n" : "\n");
+
+      vector<IdString> params;
+
+      for (auto &param : cell->parameters) {
+        params.push_back(param.first);
+      }
+
+      std::sort(params.begin(), params.end(), RTLIL::sort_by_id_str());
+
+      for (auto param : params) {
+        text << "  param " << param.str() << " "
+             << cell->parameters.at(param).as_string() << "\n";
+      }
+
+      vector<IdString> ports;
+
+      for (auto &conn : cell->connections()) {
+        ports.push_back(conn.first);
+      }
+
+      std::sort(ports.begin(), ports.end(), RTLIL::sort_by_id_str());
+
+      for (auto port : ports) {
+        text << "  connect " << port.str() << sig_str(cell->getPort(port))
+             << "\n";
+      }
+    }
+
+    vector<string> connections;
+
+    for (auto &conn : module->connections()) {
+      connections.push_back("connect" + sig_str(conn.first) + " =" +
+                            sig_str(conn.second) + "\n");
+    }
+
+    std::sort(connections.begin(), connections.end());
+
+    for (auto &conn : connections) {
+      text << conn;
+    }
+
+    // Still there after 'proc' and 'memory' only if the flow stopped early.
+    //
+    for (auto &it : module->memories) {
+      text << "memory " << it.first.str() << " " << it.second->width << " "
+           << it.second->size << "\n";
+    }
+
+    for (auto &it : module->processes) {
+      text << "process " << it.first.str() << "\n";
+    }
+
+    return text.str();
+  }
+
+  // -------------------------
+  // save_checkpoint
+  // -------------------------
+  // The '.meta' file is written last so that its presence means the '.il'
+  // file is complete.
+  //
+  void save_checkpoint(const string &stage) {
+    if (checkpoint_dir.empty() || help_mode) {
+      return;
+    }
+
+    string dir = checkpoint_dir + "/" + checkpoint_key;
+    string il_file = dir + "/" + stage + ".il";
+    string meta_file = dir + "/" + stage + ".meta";
+
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+
+    if (ec) {
+      log_warning("Cannot create checkpoint directory '%s'.\n", dir.c_str());
+      return;
+    }
+
+    run("write_rtlil " + il_file + ".tmp");
+
+    std::filesystem::rename(il_file + ".tmp", il_file, ec);
+
+    if (ec) {
+      log_warning("Cannot write checkpoint '%s'.\n", il_file.c_str());
+      return;
+    }
+
+    std::ofstream meta(meta_file + ".tmp");
+    meta << "key " << checkpoint_key << "\n";
+    meta << "stage " << stage << "\n";
+    meta << "autoidx " << autoidx << "\n";
+    meta.close();
+
+    std::filesystem::rename(meta_file + ".tmp", meta_file, ec);
+
+    if (ec) {
+      log_warning("Cannot write checkpoint '%s'.\n", meta_file.c_str());
+      return;
+    }
+
+    log("\n   Saved checkpoint '%s'\n", il_file.c_str());
+  }
+
+  // -------------------------
+  // load_checkpoint
+  // -------------------------
+  // Replace the current design by the one saved at the end of 'stage'.
+  // Return false if there is no valid checkpoint for 'stage'.
+  //
+  bool load_checkpoint(const string &stage) {
+    string dir = checkpoint_dir + "/" + checkpoint_key;
+    string il_file = dir + "/" + stage + ".il";
+
+    std::ifstream meta(dir + "/" + stage + ".meta");
+
+    if (!meta.is_open() || !std::filesystem::exists(il_file)) {
+      return false;
+    }
+
+    string tag, key, meta_stage;
+    int saved_autoidx = 0;
+
+    meta >> tag >> key >> tag >> meta_stage >> tag >> saved_autoidx;
+
+    if (meta.fail() || (key != checkpoint_key) || (meta_stage != stage)) {
+      log_warning("Ignoring corrupted checkpoint for stage '%s'.\n",
+                  stage.c_str());
+      return false;
+    }
+
+    log("\n   Restoring checkpoint '%s'\n", il_file.c_str());
+
+    run("design -reset");
+    run("read_rtlil " + il_file);
+
+    // Avoid name clashes between the restored objects and the new ones.
+    //
+    autoidx = std::max(autoidx, saved_autoidx);
+
+    return true;
+  }
+
+  // -------------------------
+  // resume_from_checkpoint
+  // -------------------------
+  // With '-run <from>:<to>', restore the checkpoint of the closest stage
+  // before <from>. If some stages in between have no checkpoint, they are
+  // replayed.
+  //
+  void resume_from_checkpoint() {
+    if (checkpoint_dir.empty() || help_mode || active_run_from.empty()) {
+      return;
+    }
+
+    int from_idx = std::find(flow_stages.begin(), flow_stages.end(),
+                             active_run_from) -
+                   flow_stages.begin();
+
+    int idx = from_idx - 1;
+
+    while ((idx >= 0) && !load_checkpoint(flow_stages[idx])) {
+      idx--;
+    }
+
+    if (idx + 1 == from_idx) {
+      return;
+    }
+
+    if (idx < 0) {
+      log_warning("No checkpoint found before stage '%s' in '%s': running "
+                  "the flow from stage '%s'.\n",
+                  active_run_from.c_str(), checkpoint_dir.c_str(),
+                  flow_stages[0].c_str());
+    } else {
+      log("\n   No checkpoint for stage '%s': replaying from stage '%s'\n",
+          flow_stages[from_idx - 1].c_str(), flow_stages[idx + 1].c_str());
+    }
+
+    // '-run <stage>' means only that stage : stop after it.
+    //
+    if (active_run_from == active_run_to) {
+      active_run_to = (from_idx + 1 < (int)flow_stages.size())
+                          ? flow_stages[from_idx + 1]
+                          : "";
+    }
+
+    active_run_from = flow_stages[idx + 1];
+  }
+
+  // ---------------------------------------
+  // Hierarchical synthesis (-hier_jobs option)
+  // ---------------------------------------
+  // Each unique module reachable from the top goes through the 'coarse' to
+  // 'abc' stages in a separate 'synth_fpga' run, so that the memory peak is
+  // bounded by the biggest module. Modules are written with their
+  // sub-modules as black boxes and read back once synthesized.
+  //
+
+  // -------------------------
+  // get_plugin_file
+  // -------------------------
+  // Plugin shared library to load in the workers, empty if the commands are
+  // built in the 'yosys' executable.
+  //
+  static string get_plugin_file() {
+#ifndef _WIN32
+    Dl_info info;
+
+    if (dladdr((void *)&SynthFpgaPass::get_plugin_file, &info) &&
+        info.dli_fname) {
+      string file = info.dli_fname;
+      if ((file.size() > 3) && (file.substr(file.size() - 3) == ".so")) {
+        return file;
+      }
+    }
+#endif
+    return "";
+  }
+
+  // -------------------------
+  // write_hier_job
+  // -------------------------
+  //
+  void write_hier_job(Module *module, const string &dir) {
+    Design *design = yosys_get_design();
+
+    std::ofstream il(dir + "/in.il");
+
+    // The worker must not create names already used in the module.
+    //
+    il << "autoidx " << autoidx << "\n";
+
+    pool<IdString> done;
+
+    for (auto cell : module->cells()) {
+
+      Module *child = design->module(cell->type);
+
+      if (!child || done.count(cell->type) ||
+          model_modules.count(cell->type)) {
+        continue;
+      }
+      done.insert(cell->type);
+
+      if (child->get_blackbox_attribute()) {
+        RTLIL_BACKEND::dump_module(il, "", child, design, false);
+        continue;
+      }
+
+      // Only the ports of the sub-module are needed.
+      //
+      Module *stub = new Module;
+      stub->name = child->name;
+      for (auto port : child->ports) {
+        stub->addWire(port, child->wire(port));
+      }
+      stub->fixup_ports();
+      stub->set_bool_attribute(ID::blackbox);
+
+      RTLIL_BACKEND::dump_module(il, "", stub, design, false);
+
+      delete stub;
+    }
+
+    bool is_top = module->get_bool_attribute(ID::top);
+
+    module->set_bool_attribute(ID::top, true);
+    RTLIL_BACKEND::dump_module(il, "", module, design, false);
+    module->set_bool_attribute(ID::top, is_top);
+
+    il.close();
+
+    std::ofstream ys(dir + "/run.ys");
+    ys << "read_rtlil in.il\n";
+    // The 'cleanup' and 'report' stages are run once on the whole design
+    // by the parent.
+    //
+    ys << "synth_fpga -run begin:cleanup" << hier_options << "\n";
+    ys << "write_rtlil out.il\n";
+    ys.close();
+  }
+
+  // -------------------------
+  // read_hier_job
+  // -------------------------
+  // Replace 'name' by its synthesized version. Return false if it cannot be
+  // found.
+  //
+  bool read_hier_job(IdString name, const string &dir) {
+    Design *design = yosys_get_design();
+
+    if (!check_file_exists(dir + "/out.il")) {
+      return false;
+    }
+
+    RTLIL::Design *result = new RTLIL::Design;
+
+    run_frontend(dir + "/out.il", "rtlil", result);
+
+    Module *synthesized = result->module(name);
+
+    if (!synthesized) {
+      delete result;
+      return false;
+    }
+
+    Module *module = synthesized->clone();
+
+    delete result;
+
+    Module *old = design->module(name);
+
+    module->set_bool_attribute(ID::top, old->get_bool_attribute(ID::top));
+
+    design->remove(old);
+    design->add(module);
+
+    return true;
+  }
+
+  // -------------------------
+  // synthesize_hierarchy
+  // -------------------------
+  // Return false if the hierarchical mode cannot be used, in which case the
+  // regular flow is run.
+  //
+  bool synthesize_hierarchy() {
+    Design *design = yosys_get_design();
+    Module *top = design->top_module();
+
+    if (!model_modules_known) {
+      log_warning("Hierarchical mode needs the 'begin' stage to run, "
+                  "ignoring -hier_jobs.\n");
+      return false;
+    }
+
+    string yosys_exe = proc_self_dirname() + proc_program_prefix() + "yosys";
+
+    if (!check_file_exists(yosys_exe, true)) {
+      log_warning("Cannot find '%s', ignoring -hier_jobs.\n",
+                  yosys_exe.c_str());
+      return false;
+    }
+
+    string plugin = get_plugin_file();
+
+    // Unique modules reachable from the top, the top being the last one.
+    //
+    vector<Module *> modules = {top};
+    dict<IdString, int> nb_instances;
+
+    for (int i = 0; i < GetSize(modules); i++) {
+      for (auto cell : modules[i]->cells()) {
+        Module *child = design->module(cell->type);
+        if (!child || child->get_blackbox_attribute() ||
+            model_modules.count(cell->type)) {
+          continue;
+        }
+        if (nb_instances[cell->type]++ == 0) {
+          modules.push_back(child);
+        }
+      }
+    }
+
+    std::reverse(modules.begin(), modules.end());
+
+    string tempdir =
+        make_temp_dir(get_base_tmpdir() + "/yosys-synth_fpga-XXXXXX");
+
+    vector<IdString> names;
+    vector<ZJob> jobs(modules.size());
+
+    for (int i = 0; i < GetSize(modules); i++) {
+      names.push_back(modules[i]->name);
+      jobs[i].dir = stringf("%s/m%d", tempdir.c_str(), i);
+      jobs[i].command = zjob_quote(yosys_exe) +
+                        (plugin.empty() ? "" : " -m " + zjob_quote(plugin)) +
+                        " -q -l yosys.log -s run.ys";
+      create_directory(jobs[i].dir);
+      write_hier_job(modules[i], jobs[i].dir);
+    }
+
+    log_header(design, "Synthesizing %d unique modules with %d jobs\n",
+               GetSize(modules), hier_jobs);
+
+    // Sub-modules first, then the top level glue.
+    //
+    vector<ZJob *> sub_jobs;
+    for (int i = 0; i + 1 < GetSize(jobs); i++) {
+      sub_jobs.push_back(&jobs[i]);
+    }
+
+    zjob_run_all(sub_jobs, hier_jobs);
+    zjob_run_all({&jobs.back()}, 1);
+
+    log("\n");
+    log("   %-40s %9s %9s %9s\n", "module", "instances", "cells", "time (s)");
+
+    for (int i = 0; i < GetSize(jobs); i++) {
+
+      if (!jobs[i].success || !read_hier_job(names[i], jobs[i].dir)) {
+
+        // The temporary directory is removed : copy the end of the log of
+        // the job before.
+        //
+        std::ifstream job_log(jobs[i].dir + "/yosys.log");
+        vector<string> lines;
+        string line;
+
+        while (std::getline(job_log, line)) {
+          lines.push_back(line);
+        }
+        job_log.close();
+
+        log("\n");
+        for (int l = std::max(0, GetSize(lines) - 50); l < GetSize(lines);
+             l++) {
+          log("   | %s\n", lines[l].c_str());
+        }
+
+        remove_directory(tempdir);
+
+        log_error("Synthesis of module '%s' failed, see its log above.\n",
+                  log_id(names[i]));
+      }
+
+      log("   %-40s %9d %9d %9.1f\n", log_id(names[i]),
+          (i + 1 < GetSize(jobs)) ? nb_instances[names[i]] : 1,
+          GetSize(design->module(names[i])->cells()), jobs[i].runtime);
+    }
+
+    remove_directory(tempdir);
+
+    return true;
+  }
+
+  // -------------------------
+  // clean_design
+  // -------------------------
+  //
+  void clean_design() {
+    if (obs_clean) {
+
+      // This is usefull to get non-LUT cells IOs directions to allow
+      // the 'obs_clean' traversal to correctly operate.
+      //
+      load_bb_cells_models();
+
+      run("obs_clean");
+
+      run("hierarchy");
+
+      show_stat();
+
+    } else {
+
+      run("opt_clean");
+    }
+  }
+
+  // -------------------------
+  // abc_script_costs
+  // -------------------------
+  // Runtime model of the ABC scripts : seconds per million of AIG nodes
+  // (DFFs count as nodes since they become ABC inputs/outputs), scaled by
+  // log2(2 + logic levels). Scripts are listed from best to worst QoR.
+  //
+  // The model is NOT calibrated : only the 'delay' and 'fast_delay' costs
+  // come from a measurement ('e203_soc_top', 5000 and 1400 sec.), the other
+  // ones are guesses. With -abc_jobs the runtime is divided by the number of
+  // jobs, assuming a perfect scaling. Use the predicted/actual report to
+  // refine them.
+  //
+  struct abc_script_cost {
+    const char *mode;
+    double sec_per_mnode;
+  };
+
+  static const vector<abc_script_cost> &abc_script_costs(const string &opt) {
+
+    static const vector<abc_script_cost> delay_costs = {
+        {"tiny_delay", 3000.0}, {"small_delay", 2000.0}, {"delay", 1100.0},
+        {"fast_delay", 310.0},  {"huge", 30.0},
+    };
+
+    static const vector<abc_script_cost> area_costs = {
+        {"tiny_area", 2000.0}, {"small_area", 1200.0}, {"area", 700.0},
+        {"fast_area", 200.0},  {"fast", 200.0},        {"huge", 30.0},
+    };
+
+    return (opt == "delay") ? delay_costs : area_costs;
+  }
+
+  // -------------------------
+  // aig_weight
+  // -------------------------
+  // Number of AIG nodes of a simple gate, -1 if it is not a simple gate.
+  //
+  static int aig_weight(IdString type) {
+
+    if (type.in(ID($_BUF_), ID($_NOT_))) {
+      return 0;
+    }
+    if (type.in(ID($_AND_), ID($_NAND_), ID($_OR_), ID($_NOR_),
+                ID($_ANDNOT_), ID($_ORNOT_))) {
+      return 1;
+    }
+    if (type.in(ID($_AOI3_), ID($_OAI3_))) {
+      return 2;
+    }
+    if (type.in(ID($_XOR_), ID($_XNOR_), ID($_MUX_), ID($_NMUX_),
+                ID($_AOI4_), ID($_OAI4_))) {
+      return 3;
+    }
+    return -1;
+  }
+
+  // -------------------------
+  // get_abc_problem_size
+  // -------------------------
+  // AIG nodes, logic levels and DFFs of the logic handed to ABC.
+  //
+  void get_abc_problem_size(int &nb_nodes, int &nb_levels, int &nb_dffs) {
+
+    nb_nodes = 0;
+    nb_levels = 0;
+    nb_dffs = getNumberOfDffs();
+
+    for (auto module : yosys_get_design()->selected_modules()) {
+
+      SigMap sigmap(module);
+
+      dict<SigBit, Cell *> driver;
+      vector<Cell *> gates;
+
+      for (auto cell : module->cells()) {
+
+        int weight = aig_weight(cell->type);
+
+        if (weight < 0) {
+          continue;
+        }
+
+        nb_nodes += weight;
+        gates.push_back(cell);
+
+        for (auto bit : sigmap(cell->getPort(ID::Y))) {
+          driver[bit] = cell;
+        }
+      }
+
+      // Levelize the gates (Kahn). Gates on combinational loops are left
+      // out.
+      //
+      dict<Cell *, int> nb_fanins;
+      dict<Cell *, vector<Cell *>> fanouts;
+      dict<Cell *, int> level;
+
+      for (auto cell : gates) {
+
+        nb_fanins[cell] = 0;
+
+        for (auto &conn : cell->connections()) {
+
+          if (conn.first == ID::Y) {
+            continue;
+          }
+
+          for (auto bit : sigmap(conn.second)) {
+            if (driver.count(bit)) {
+              fanouts[driver.at(bit)].push_back(cell);
+              nb_fanins[cell]++;
+            }
+          }
+        }
+      }
+
+      vector<Cell *> ready;
+
+      for (auto cell : gates) {
+        if (nb_fanins[cell] == 0) {
+          ready.push_back(cell);
+        }
+      }
+
+      while (!ready.empty()) {
+
+        Cell *cell = ready.back();
+        ready.pop_back();
+
+        int cell_level = level[cell] + (aig_weight(cell->type) > 0 ? 1 : 0);
+
+        nb_levels = std::max(nb_levels, cell_level);
+
+        for (auto fanout : fanouts[cell]) {
+          level[fanout] = std::max(level[fanout], cell_level);
+          if (--nb_fanins[fanout] == 0) {
+            ready.push_back(fanout);
+          }
+        }
+      }
+    }
+  }
+
+  // -------------------------
+  // select_abc_mode_for_budget
+  // -------------------------
+  // Return the best QoR ABC script mode whose predicted runtime fits in
+  // 'time_budget', or the fastest one. 'predicted' gets its runtime.
+  //
+  string select_abc_mode_for_budget(double &predicted) {
+
+    int nb_nodes, nb_levels, nb_dffs;
+
+    get_abc_problem_size(nb_nodes, nb_levels, nb_dffs);
+
+    log_header(yosys_get_design(),
+               "Selecting ABC script for a %.1f sec. time budget\n",
+               time_budget);
+
+    log("   AIG nodes : %d, levels : %d, DFFs : %d\n\n", nb_nodes, nb_levels,
+        nb_dffs);
+
+    double mnodes = (nb_nodes + nb_dffs) / 1000000.0;
+    double level_factor = std::log2(2.0 + nb_levels);
+
+    string selected = "";
+    string fastest = "";
+    double fastest_time = 0;
+
+    for (auto &cost : abc_script_costs(opt)) {
+
+      string mode = cost.mode;
+
+      string abc_script = proc_share_dirname() + "plugins/wildebeest/" +
+                          "abc_scripts/LUT" + sc_syn_lut_size + "/" +
+                          abc_script_version + "/" + mode + "_lut" +
+                          sc_syn_lut_size + ".scr";
+
+      if (!check_file_exists(abc_script)) {
+        continue;
+      }
+
+      double estimate =
+          cost.sec_per_mnode * mnodes * level_factor / abc_jobs;
+
+      log("   %-12s : %10.1f sec.%s\n", mode.c_str(), estimate,
+          (selected.empty() && (estimate <= time_budget)) ? " <-" : "");
+
+      if (selected.empty() && (estimate <= time_budget)) {
+        selected = mode;
+        predicted = estimate;
+      }
+
+      fastest = mode;
+      fastest_time = estimate;
+    }
+
+    if (fastest.empty()) {
+      log_error("No ABC script found for LUT%s '%s' version.\n",
+                sc_syn_lut_size.c_str(), abc_script_version.c_str());
+    }
+
+    if (selected.empty()) {
+
+      log_warning("No ABC script fits the %.1f sec. time budget, using the "
+                  "fastest one '%s'\n",
+                  time_budget, fastest.c_str());
+
+      selected = fastest;
+      predicted = fastest_time;
+    }
+
+    return selected;
+  }
+
+  // ---------------------------------------
+  // ABC mapping cache (-abc_cache option)
+  // ---------------------------------------
+  // An entry is '<key>.il', the design after mapping, and '<key>.meta',
+  // written last, holding its 'autoidx'. Entry file dates are used for the
+  // LRU eviction. Hit/miss counters are kept in the 'stats' file.
+  //
+
+  // -------------------------
+  // compute_abc_cache_key
+  // -------------------------
+  //
+  string compute_abc_cache_key(const string &command,
+                               const string &abc_script) {
+    uint64_t hash = fnv1a_hash(SYNTH_FPGA_VERSION);
+
+    hash = fnv1a_hash(command, hash);
+    hash = fnv1a_hash(sc_syn_lut_size, hash);
+
+    if (!abc_script.empty()) {
+      string script_file = abc_script;
+      rewrite_filename(script_file);
+
+      std::ifstream scr(script_file);
+      std::stringstream content;
+      content << scr.rdbuf();
+      hash = fnv1a_hash(content.str(), hash);
+    }
+
+    hash = hash_design(hash);
+
+    return stringf("%016llx", (unsigned long long)hash);
+  }
+
+  // -------------------------
+  // update_abc_cache_stats
+  // -------------------------
+  //
+  void update_abc_cache_stats(bool hit) {
+    string stats_file = abc_cache_dir + "/stats";
+
+    int hits = 0, misses = 0;
+    string tag;
+
+    std::ifstream in(stats_file);
+    if (in.is_open()) {
+      in >> tag >> hits >> tag >> misses;
+      in.close();
+    }
+
+    (hit ? hits : misses)++;
+
+    std::ofstream out(stats_file);
+    out << "hits " << hits << "\n";
+    out << "misses " << misses << "\n";
+    out.close();
+
+    // Entries and size of the cache.
+    //
+    int nb_entries = 0;
+    uintmax_t total_size = 0;
+    std::error_code ec;
+
+    for (auto &entry :
+         std::filesystem::directory_iterator(abc_cache_dir, ec)) {
+      if (entry.path().extension() == ".il") {
+        nb_entries++;
+        total_size += entry.file_size(ec);
+      }
+    }
+
+    log("\n   ABC cache %s : %d hits, %d misses (%.0f%% hit rate), %d "
+        "entries, %.1f MB\n",
+        hit ? "hit" : "miss", hits, misses,
+        100.0 * hits / (hits + misses), nb_entries,
+        total_size / (1024.0 * 1024.0));
+  }
+
+  // -------------------------
+  // evict_abc_cache
+  // -------------------------
+  // Remove the least recently used entries until the cache fits in
+  // 'abc_cache_size' MB.
+  //
+  void evict_abc_cache() {
+    vector<pair<std::filesystem::file_time_type, std::filesystem::path>>
+        entries;
+    uintmax_t total_size = 0;
+    std::error_code ec;
+
+    for (auto &entry :
+         std::filesystem::directory_iterator(abc_cache_dir, ec)) {
+      if (entry.path().extension() == ".il") {
+        entries.push_back({entry.last_write_time(ec), entry.path()});
+        total_size += entry.file_size(ec);
+      }
+    }
+
+    std::sort(entries.begin(), entries.end());
+
+    uintmax_t max_size = (uintmax_t)abc_cache_size * 1024 * 1024;
+
+    for (auto &entry : entries) {
+
+      if (total_size <= max_size) {
+        break;
+      }
+
+      std::filesystem::path meta = entry.second;
+      meta.replace_extension(".meta");
+
+      total_size -= std::filesystem::file_size(entry.second, ec);
+
+      std::filesystem::remove(meta, ec);
+      std::filesystem::remove(entry.second, ec);
+
+      log("   Evicted ABC cache entry '%s'\n", entry.second.string().c_str());
+    }
+  }
+
+  // -------------------------
+  // run_abc_cached
+  // -------------------------
+  // Run the ABC 'command' unless its result is in the '-abc_cache'
+  // directory.
+  //
+  void run_abc_cached(const string &command, const string &abc_script) {
+    if (abc_cache_dir.empty() || help_mode) {
+      run(command);
+      return;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(abc_cache_dir, ec);
+
+    if (ec) {
+      log_warning("Cannot create ABC cache directory '%s'.\n",
+                  abc_cache_dir.c_str());
+      run(command);
+      return;
+    }
+
+    string key = compute_abc_cache_key(command, abc_script);
+    string il_file = abc_cache_dir + "/" + key + ".il";
+    string meta_file = abc_cache_dir + "/" + key + ".meta";
+
+    std::ifstream meta(meta_file);
+
+    if (meta.is_open() && std::filesystem::exists(il_file)) {
+
+      string tag, meta_key;
+      int saved_autoidx = 0;
+
+      meta >> tag >> meta_key >> tag >> saved_autoidx;
+      meta.close();
+
+      if (!meta.fail() && (meta_key == key)) {
+
+        log("\n   Restoring ABC result '%s'\n", il_file.c_str());
+
+        run("design -reset");
+        run("read_rtlil " + il_file);
+
+        autoidx = std::max(autoidx, saved_autoidx);
+
+        // Most recently used.
+        //
+        std::filesystem::last_write_time(
+            il_file, std::filesystem::file_time_type::clock::now(), ec);
+
+        update_abc_cache_stats(true);
+        return;
+      }
+
+      log_warning("Ignoring corrupted ABC cache entry '%s'.\n",
+                  il_file.c_str());
+    }
+
+    run(command);
+
+    // A result cut short by the ABC watchdog is not kept.
+    //
+    if (yosys_get_design()->scratchpad_get_bool("zabc.timed_out")) {
+      update_abc_cache_stats(false);
+      return;
+    }
+
+    run("write_rtlil " + il_file + ".tmp");
+
+    std::filesystem::rename(il_file + ".tmp", il_file, ec);
+
+    if (!ec) {
+      std::ofstream out(meta_file + ".tmp");
+      out << "key " << key << "\n";
+      out << "autoidx " << autoidx << "\n";
+      out.close();
+
+      std::filesystem::rename(meta_file + ".tmp", meta_file, ec);
+    }
+
+    if (ec) {
+      log_warning("Cannot write ABC cache entry '%s'.\n", il_file.c_str());
+    }
+
+    update_abc_cache_stats(false);
+
+    evict_abc_cache();
+  }
+
+  // ---------------------------------------
+  // ABC portfolio (-abc_portfolio option)
+  // ---------------------------------------
+  // Each script version maps a copy of the design in its own 'yosys'
+  // process. The winner is read back in place of the current design.
+  //
+
+  // -------------------------
+  // get_lut_qor
+  // -------------------------
+  // Number of LUTs and max LUT depth of 'design'.
+  //
+  static void get_lut_qor(Design *design, int &nb_luts, int &depth) {
+    nb_luts = 0;
+    depth = 0;
+
+    for (auto module : design->modules()) {
+
+      if (module->get_blackbox_attribute()) {
+        continue;
+      }
+
+      SigMap sigmap(module);
+
+      dict<SigBit, Cell *> driver;
+      vector<Cell *> luts;
+
+      for (auto cell : module->cells()) {
+        if (cell->type != ID($lut)) {
+          continue;
+        }
+        luts.push_back(cell);
+        for (auto bit : sigmap(cell->getPort(ID::Y))) {
+          driver[bit] = cell;
+        }
+      }
+
+      nb_luts += GetSize(luts);
+
+      dict<Cell *, int> nb_fanins;
+      dict<Cell *, vector<Cell *>> fanouts;
+      dict<Cell *, int> level;
+
+      for (auto cell : luts) {
+        nb_fanins[cell] = 0;
+        for (auto bit : sigmap(cell->getPort(ID::A))) {
+          if (driver.count(bit)) {
+            fanouts[driver.at(bit)].push_back(cell);
+            nb_fanins[cell]++;
+          }
+        }
+      }
+
+      vector<Cell *> ready;
+
+      for (auto cell : luts) {
+        if (nb_fanins[cell] == 0) {
+          ready.push_back(cell);
+        }
+      }
+
+      while (!ready.empty()) {
+
+        Cell *cell = ready.back();
+        ready.pop_back();
+
+        int cell_level = level[cell] + 1;
+
+        depth = std::max(depth, cell_level);
+
+        for (auto fanout : fanouts[cell]) {
+          level[fanout] = std::max(level[fanout], cell_level);
+          if (--nb_fanins[fanout] == 0) {
+            ready.push_back(fanout);
+          }
+        }
+      }
+    }
+  }
+
+  // -------------------------
+  // run_abc_portfolio
+  // -------------------------
+  // Return false if no version succeeded, the design being unchanged.
+  //
+  bool run_abc_portfolio(const string &mode) {
+    Design *design = yosys_get_design();
+
+    string yosys_exe = proc_self_dirname() + proc_program_prefix() + "yosys";
+
+    if (!check_file_exists(yosys_exe, true)) {
+      log_warning("Cannot find '%s', ignoring -abc_portfolio.\n",
+                  yosys_exe.c_str());
+      return false;
+    }
+
+    string plugin = get_plugin_file();
+
+    string tempdir =
+        make_temp_dir(get_base_tmpdir() + "/yosys-abc_portfolio-XXXXXX");
+
+    run("write_rtlil " + tempdir + "/in.il");
+
+    vector<string> versions;
+    vector<ZJob> jobs;
+
+    for (auto &item : split_tokens(abc_portfolio, ",")) {
+
+      string version = item;
+      double timeout = abc_portfolio_timeout;
+
+      size_t colon = item.find(':');
+      if (colon != string::npos) {
+        version = item.substr(0, colon);
+        timeout = atof(item.substr(colon + 1).c_str());
+      }
+
+      // Older versions do not have all the size specific scripts.
+      //
+      string script_dir = proc_share_dirname() +
+                          "plugins/wildebeest/abc_scripts/LUT" +
+                          sc_syn_lut_size + "/" + version + "/";
+      string abc_script = script_dir + mode + "_lut" + sc_syn_lut_size + ".scr";
+
+      if (!check_file_exists(abc_script)) {
+        abc_script = script_dir + opt + "_lut" + sc_syn_lut_size + ".scr";
+      }
+
+      if (!check_file_exists(abc_script)) {
+        log_warning("No '%s' ABC script for version '%s', skipping it.\n",
+                    mode.c_str(), version.c_str());
+        continue;
+      }
+
+      ZJob job;
+      job.dir = stringf("%s/v%d", tempdir.c_str(), GetSize(jobs));
+      job.timeout = timeout;
+      job.command = zjob_quote(yosys_exe) +
+                    (plugin.empty() ? "" : " -m " + zjob_quote(plugin)) +
+                    " -q -l yosys.log -s run.ys";
+
+      create_directory(job.dir);
+
+      std::ofstream ys(job.dir + "/run.ys");
+      ys << "read_rtlil ../in.il\n";
+      if (abc_jobs > 1) {
+        ys << "zabc -script " << abc_script << " -jobs " << abc_jobs << "\n";
+      } else {
+        ys << "abc -script " << abc_script << "\n";
+      }
+      ys << "write_rtlil out.il\n";
+      ys.close();
+
+      versions.push_back(version);
+      jobs.push_back(job);
+    }
+
+    if (jobs.empty()) {
+      remove_directory(tempdir);
+      return false;
+    }
+
+    log_header(design, "Racing %d ABC script versions in '%s' mode\n",
+               GetSize(jobs), mode.c_str());
+
+    vector<ZJob *> all_jobs;
+    for (auto &job : jobs) {
+      all_jobs.push_back(&job);
+    }
+
+    // Each version runs 'abc_jobs' ABC processes : race as many versions
+    // as the cores allow, the others wait for a free slot.
+    //
+    int nb_cores = std::max(1, (int)std::thread::hardware_concurrency());
+    int nb_parallel =
+        std::max(1, std::min(GetSize(all_jobs), nb_cores / abc_jobs));
+
+    if (nb_parallel < GetSize(all_jobs)) {
+      log("   Running %d versions at a time on %d cores (%d ABC jobs each).\n",
+          nb_parallel, nb_cores, abc_jobs);
+    }
+
+    zjob_run_all(all_jobs, nb_parallel);
+
+    // Compare the results on the '-opt' objective.
+    //
+    int best = -1;
+    int best_luts = 0, best_depth = 0;
+    vector<int> nb_luts(jobs.size(), 0), depth(jobs.size(), 0);
+
+    for (int i = 0; i < GetSize(jobs); i++) {
+
+      if (!jobs[i].success) {
+        continue;
+      }
+
+      Design *result = new Design;
+      run_frontend(jobs[i].dir + "/out.il", "rtlil", result);
+      get_lut_qor(result, nb_luts[i], depth[i]);
+      delete result;
+
+      pair<int, int> cost = (opt == "delay")
+                                ? std::make_pair(depth[i], nb_luts[i])
+                                : std::make_pair(nb_luts[i], depth[i]);
+      pair<int, int> best_cost = (opt == "delay")
+                                     ? std::make_pair(best_depth, best_luts)
+                                     : std::make_pair(best_luts, best_depth);
+
+      if ((best < 0) || (cost < best_cost)) {
+        best = i;
+        best_luts = nb_luts[i];
+        best_depth = depth[i];
+      }
+    }
+
+    log("\n");
+    log("   %-10s %-9s %9s %7s %9s\n", "version", "status", "LUTs", "depth",
+        "time (s)");
+
+    for (int i = 0; i < GetSize(jobs); i++) {
+
+      const char *status =
+          jobs[i].timed_out ? "timeout" : (jobs[i].success ? "done" : "failed");
+
+      if (jobs[i].success) {
+        log("   %-10s %-9s %9d %7d %9.1f%s\n", versions[i].c_str(), status,
+            nb_luts[i], depth[i], jobs[i].runtime, (i == best) ? " <-" : "");
+      } else {
+        log("   %-10s %-9s %9s %7s %9.1f\n", versions[i].c_str(), status, "-",
+            "-", jobs[i].runtime);
+      }
+    }
+
+    if (best < 0) {
+      log_warning("All ABC portfolio versions failed, see '%s'.\n",
+                  tempdir.c_str());
+      return false;
+    }
+
+    log("\n   Keeping ABC result of version '%s'\n", versions[best].c_str());
+
+    run("design -reset");
+    run("read_rtlil " + jobs[best].dir + "/out.il");
+
+    remove_directory(tempdir);
+
+    return true;
+  }
+
+  // -------------------------
+  // abc_synthesize
+  // -------------------------
+  //
+  void abc_synthesize() {
+    if (!yosys_get_design()) {
+      log_warning("Design seems empty ! (did you define the -top or use "
+                  "'hierarchy -auto-top' before)\n");
+      return;
+    }
+
+    show_stat();
+
+    if (opt == "") {
+      log_header(yosys_get_design(),
+                 "Performing OFFICIAL PLATYPUS optimization\n");
+      run_abc_cached("abc -lut " + sc_syn_lut_size, "");
+      return;
+    }
+
+#if 0
+    run("show -prefix before_abc");
+#endif
+
+    string mode = opt;
+
+    // Switch to FAST ABC synthesis script for huge designs in order to avoid
+    // runtime blow up.
+    //
+    // ex: 'ifu', 'l2c', 'e203' designs will be impacted with sometime slight
+    // max level degradation but with nice speed-up (ex: 'e203' from 5000 sec.
+    // downto 1400 sec.)
+    //
+    int nb_cells = getNumberOfCells();
+
+    // With a time budget the script is chosen from its predicted runtime.
+    //
+    double predicted = -1;
+
+    if (time_budget > 0) {
+
+      mode = select_abc_mode_for_budget(predicted);
+
+    } else if (nb_cells <= TINY_NB_CELLS) {
+
+      if ((mode == "area") || (abc_script_version == "BASIC")) {
+
+        mode = "tiny_area";
+
+      } else if (mode == "delay") {
+
+        mode = "tiny_delay";
+      }
+
+    } else if (nb_cells <= SMALL_NB_CELLS) {
+
+      if ((mode == "area") || (abc_script_version == "BASIC")) {
+
+        mode = "small_area";
+
+      } else if (mode == "delay") {
+
+        mode = "small_delay";
+      }
+
+    } else if (nb_cells >=
+               HUGE_NB_CELLS) { // example : 'zmcml' from Golden suite
+
+      mode = "huge";
+
+      log_warning("Optimization script changed from '%s' to '%s' due to design "
+                  "size (%d cells)\n",
+                  opt.c_str(), mode.c_str(), nb_cells);
+
+    } else if (nb_cells >=
+               BIG_NB_CELLS) { // example : 'e203_soc_top' from Golden suite
+
+      if (mode == "delay") {
+
+        mode = "fast_delay";
+
+      } else {
+
+        mode = "fast_area";
+      }
+
+      log_warning("Optimization script changed from '%s' to '%s' due to design "
+                  "size (%d cells)\n",
+                  opt.c_str(), mode.c_str(), nb_cells);
+    }
+
+    // Otherwise specific ABC script based flow
+    //
+    string abc_script = "+/plugins/wildebeest/abc_scripts/LUT" +
+                        sc_syn_lut_size + "/" + abc_script_version + "/" +
+                        mode + "_lut" + sc_syn_lut_size + ".scr";
+
+    log_header(yosys_get_design(), "Calling ABC script in '%s' mode\n",
+               mode.c_str());
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // The portfolio falls back to the single script if all versions fail.
+    //
+    if (abc_portfolio.empty() || help_mode || !run_abc_portfolio(mode)) {
+
+      if ((abc_timeout > 0) || (abc_step_timeout > 0)) {
+        run_abc_cached(
+            stringf("zabc -script %s -jobs %d -timeout %g -step_timeout %g "
+                    "-lut %s",
+                    abc_script.c_str(), abc_jobs, abc_timeout,
+                    abc_step_timeout, sc_syn_lut_size.c_str()),
+            abc_script);
+      } else if (abc_jobs > 1) {
+        run_abc_cached(stringf("zabc -script %s -jobs %d", abc_script.c_str(),
+                               abc_jobs),
+                       abc_script);
+      } else {
+        run_abc_cached("abc -script " + abc_script, abc_script);
+      }
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+
+    if (predicted >= 0) {
+      log("ABC script '%s' runtime : predicted %.1f sec., actual %.1f sec.\n",
+          mode.c_str(), predicted,
+          std::chrono::duration<double>(endTime - startTime).count());
+    }
+  }
+
+  // -------------------------
+  // legalize_flops
+  // -------------------------
+  // Code picked up from procedure 'legalize_flops' in TCL
+  // 'sc_synth_fpga.tcl' (Thierry)
+  // DFF features considered so far :
+  //     - enable
+  //     - async_set
+  //     - async_reset
+  //
+  void legalize_flops() {
+    string legalize_list = format_legal_flops();
+    run("dfflegalize" + legalize_list);
   }
 
   bool has_cell_type(RTLIL::Design *design, const std::string &target_type) {
@@ -2801,7 +4300,7 @@ struct SynthFpgaPass : public ScriptPass {
       sc_syn_bram_techmap += " -map " + it;
     }
 
-    run("stat");
+    show_stat();
 
 #if 0
      log("Call %s\n", sc_syn_bram_memory_libmap.c_str());
@@ -2819,7 +4318,7 @@ struct SynthFpgaPass : public ScriptPass {
 
     run(sc_syn_bram_techmap);
 
-    run("stat");
+    show_stat();
   }
 
   // -------------------------
@@ -2835,7 +4334,7 @@ struct SynthFpgaPass : public ScriptPass {
       return;
     }
 
-    run("stat");
+    show_stat();
 
     run("memory_dff"); // 'dsp' will merge registers, reserve memory port
                        // registers first
@@ -2863,7 +4362,7 @@ struct SynthFpgaPass : public ScriptPass {
 
     run(sc_syn_dsps_techmap);
 
-    run("stat");
+    show_stat();
     run("select a:mul2dsp");
     run("setattr -unset mul2dsp");
     run("opt_expr -fine");
@@ -2885,7 +4384,7 @@ struct SynthFpgaPass : public ScriptPass {
 
     run("chtype -set $mul t:$__soft_mul");
 
-    run("stat");
+    show_stat();
 
     if (has_cell_type(yosys_get_design(), "\\MAE")) {
       log_error("Could not techmap DSP to a valid configuration.\n");
@@ -2899,12 +4398,14 @@ struct SynthFpgaPass : public ScriptPass {
   // because we are re-optimizing and re-mapping a netlist.
   //
   void resynthesize() {
-    run("stat");
+    show_stat();
 
     run("proc");
 
     run("flatten");
 
+    recount_stats();
+
     run("techmap -map +/techmap.v");
 
     run("techmap");
@@ -2948,7 +4449,7 @@ struct SynthFpgaPass : public ScriptPass {
     analyze_undriven_nets(yosys_get_design()->top_module(),
                           true /* connect undriven nets to undef */);
 
-    run("stat");
+    show_stat();
   }
 
   // -------------------------
@@ -3145,19 +4646,89 @@ struct SynthFpgaPass : public ScriptPass {
         "default.\n");
     log("\n");
 
-    log("    -stop_if_undriven_nets\n");
-    log("        Stop Synthesis if the final netlist has undriven nets. This "
-        "is off by default.\n");
+    log("    -stop_if_undriven_nets\n");
+    log("        Stop Synthesis if the final netlist has undriven nets. This "
+        "is off by default.\n");
+
+    log("\n");
+    log("    -obs_clean\n");
+    log("        specifies to use 'obs_clean' cleanup function instead of "
+        "regular \n");
+    log("        'opt_clean'. This is off by default.\n");
+    log("\n");
+
+    log("    -lut_size\n");
+    log("        specifies lut size. By default lut size is 4.\n");
+    log("\n");
+
+    log("    -hier_jobs <N>\n");
+    log("        With -no_flatten, synthesize each unique module once in its "
+        "own 'yosys'\n");
+    log("        process, up to <N> at the same time, sub-modules being seen as "
+        "black\n");
+    log("        boxes. The top module is synthesized last. This is off by "
+        "default.\n");
+    log("\n");
+
+    log("    -abc_portfolio <version>[:<sec>],...\n");
+    log("        Run the ABC script of each listed version (ex: 'BEST,V6:600,"
+        "V8')\n");
+    log("        concurrently on copies of the netlist and keep the best "
+        "result : least\n");
+    log("        LUTs with '-opt area', least LUT levels with '-opt delay', "
+        "the other\n");
+    log("        criterion breaking ties. A version is stopped after <sec> "
+        "seconds if\n");
+    log("        given. This overrides -abc_script_version. No more versions "
+        "than the\n");
+    log("        cores divided by '-abc_jobs' run at the same time.\n");
+    log("\n");
+    log("    -abc_portfolio_timeout <sec>\n");
+    log("        Default timeout of the '-abc_portfolio' versions. By default "
+        "there is\n");
+    log("        none.\n");
+    log("\n");
+
+    log("    -abc_timeout <sec>\n");
+    log("        Stop ABC after <sec> seconds and continue with the network of "
+        "the last\n");
+    log("        '&save' of the script. ABC is then run by 'zabc'.\n");
+    log("\n");
+    log("    -abc_step_timeout <sec>\n");
+    log("        Same as -abc_timeout but for a single line of the ABC "
+        "script.\n");
+    log("\n");
 
+    log("    -abc_cache <dir>\n");
+    log("        Keep the ABC mapping results in <dir>, keyed by the netlist "
+        "handed to\n");
+    log("        ABC, the ABC script and the LUT size. On a hit, the mapped "
+        "netlist is\n");
+    log("        restored and ABC is skipped.\n");
     log("\n");
-    log("    -obs_clean\n");
-    log("        specifies to use 'obs_clean' cleanup function instead of "
-        "regular \n");
-    log("        'opt_clean'. This is off by default.\n");
+    log("    -abc_cache_size <MB>\n");
+    log("        Size limit of the '-abc_cache' directory. Least recently "
+        "used entries\n");
+    log("        are evicted beyond it. By default it is 2048 MB.\n");
     log("\n");
 
-    log("    -lut_size\n");
-    log("        specifies lut size. By default lut size is 4.\n");
+    log("    -time_budget <sec>\n");
+    log("        Pick the ABC script with the best expected QoR whose "
+        "predicted runtime\n");
+    log("        fits in <sec> seconds, instead of choosing it from the "
+        "number of cells.\n");
+    log("        Predicted and actual ABC runtimes are reported. The "
+        "runtime model is\n");
+    log("        not calibrated : predictions are rough estimates.\n");
+    log("\n");
+
+    log("    -abc_jobs <N>\n");
+    log("        Cut the combinational logic into partitions bounded by FFs "
+        "and ports\n");
+    log("        and map them with up to <N> concurrent ABC processes (see "
+        "'zabc').\n");
+    log("        By default the whole design is mapped by a single ABC "
+        "call.\n");
     log("\n");
 
     log("    -verilog <file>\n");
@@ -3175,6 +4746,38 @@ struct SynthFpgaPass : public ScriptPass {
     log("        Dump a 'stat.csv' file. This is off by default.\n");
     log("\n");
 
+    log("    -trace <file>\n");
+    log("        Measure wall time, CPU time, peak memory growth and cell count "
+        "of each\n");
+    log("        command of the flow. A summary table sorted by wall time is "
+        "printed at\n");
+    log("        the end of the log and the commands are dumped in <file> as "
+        "Chrome\n");
+    log("        trace events (JSON). This is off by default.\n");
+    log("\n");
+
+    log("    -run <from_label>[:<to_label>]\n");
+    log("        only run the commands between the labels (see below). an empty\n");
+    log("        from label is synonymous to 'begin', and empty to label is\n");
+    log("        synonymous to the end of the flow. The labels are, in order :\n");
+    log("        begin, coarse, dsp, bram, dff_opt, legalize, abc, cleanup, "
+        "report.\n");
+    log("\n");
+
+    log("    -checkpoint_dir <dir>\n");
+    log("        Save the design at the end of each stage under <dir>, keyed by "
+        "a hash\n");
+    log("        of the input design, config file and options. With '-run', the "
+        "flow\n");
+    log("        restarts from the last checkpoint found before <from_label>.\n");
+    log("\n");
+
+    log("    -verbose\n");
+    log("        Print the full 'stat' report at each step of the flow instead "
+        "of the\n");
+    log("        summary of the incrementally maintained design stats.\n");
+    log("\n");
+
     log("    -wait\n");
     log("        wait after each 'stat' report for user to touch <enter> key. "
         "Help for \n");
@@ -3219,6 +4822,7 @@ struct SynthFpgaPass : public ScriptPass {
     continue_if_latch = false;
 
     wait = false;
+    verbose = false;
 
     dff_enable = true;
     dff_async_reset = true;
@@ -3229,8 +4833,25 @@ struct SynthFpgaPass : public ScriptPass {
     stop_if_undriven_nets = false;
 
     verilog_file = "";
+    trace_file = "";
+    checkpoint_dir = "";
+    checkpoint_options = "";
+    checkpoint_key = "";
+    current_stage = "";
 
     abc_script_version = "BEST";
+    abc_jobs = 1;
+    abc_cache_dir = "";
+    abc_cache_size = 2048;
+    abc_portfolio = "";
+    abc_portfolio_timeout = 0;
+    abc_timeout = 0;
+    abc_step_timeout = 0;
+    time_budget = 0;
+    hier_jobs = 0;
+    hier_options = "";
+    model_modules.clear();
+    model_modules_known = false;
 
     sc_syn_lut_size = "4";
     sc_syn_fsm_encoding = "one-hot";
@@ -3370,6 +4991,73 @@ struct SynthFpgaPass : public ScriptPass {
         continue;
       }
 
+      if (args[argidx] == "-hier_jobs" && argidx + 1 < args.size()) {
+        hier_jobs = atoi(args[++argidx].c_str());
+        if (hier_jobs < 1) {
+          log_cmd_error("-hier_jobs value must be at least 1.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-time_budget" && argidx + 1 < args.size()) {
+        time_budget = atof(args[++argidx].c_str());
+        if (time_budget <= 0) {
+          log_cmd_error("-time_budget value must be positive.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-abc_portfolio" && argidx + 1 < args.size()) {
+        abc_portfolio = args[++argidx];
+        continue;
+      }
+
+      if (args[argidx] == "-abc_portfolio_timeout" &&
+          argidx + 1 < args.size()) {
+        abc_portfolio_timeout = atof(args[++argidx].c_str());
+        if (abc_portfolio_timeout < 0) {
+          log_cmd_error("-abc_portfolio_timeout value must be positive.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-abc_timeout" && argidx + 1 < args.size()) {
+        abc_timeout = atof(args[++argidx].c_str());
+        if (abc_timeout <= 0) {
+          log_cmd_error("-abc_timeout value must be positive.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-abc_step_timeout" && argidx + 1 < args.size()) {
+        abc_step_timeout = atof(args[++argidx].c_str());
+        if (abc_step_timeout <= 0) {
+          log_cmd_error("-abc_step_timeout value must be positive.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-abc_cache" && argidx + 1 < args.size()) {
+        abc_cache_dir = args[++argidx];
+        continue;
+      }
+
+      if (args[argidx] == "-abc_cache_size" && argidx + 1 < args.size()) {
+        abc_cache_size = atoi(args[++argidx].c_str());
+        if (abc_cache_size < 1) {
+          log_cmd_error("-abc_cache_size value must be at least 1.\n");
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-abc_jobs" && argidx + 1 < args.size()) {
+        abc_jobs = atoi(args[++argidx].c_str());
+        if (abc_jobs < 1) {
+          log_cmd_error("-abc_jobs value must be at least 1.\n");
+        }
+        continue;
+      }
+
       if (args[argidx] == "-fsm_encoding" && argidx + 1 < args.size()) {
         sc_syn_fsm_encoding = args[++argidx];
         continue;
@@ -3425,6 +5113,33 @@ struct SynthFpgaPass : public ScriptPass {
         continue;
       }
 
+      if (args[argidx] == "-trace" && argidx + 1 < args.size()) {
+        trace_file = args[++argidx];
+        continue;
+      }
+
+      if (args[argidx] == "-checkpoint_dir" && argidx + 1 < args.size()) {
+        checkpoint_dir = args[++argidx];
+        continue;
+      }
+
+      if (args[argidx] == "-run" && argidx + 1 < args.size()) {
+        size_t pos = args[argidx + 1].find(':');
+        if (pos == std::string::npos) {
+          run_from = args[++argidx];
+          run_to = args[argidx];
+        } else {
+          run_from = args[++argidx].substr(0, pos);
+          run_to = args[argidx].substr(pos + 1);
+        }
+        continue;
+      }
+
+      if (args[argidx] == "-verbose") {
+        verbose = true;
+        continue;
+      }
+
       // for debug, flow analysis
       //
       if (args[argidx] == "-wait") {
@@ -3440,11 +5155,72 @@ struct SynthFpgaPass : public ScriptPass {
       log_cmd_error("This command only operates on fully selected designs!\n");
     }
 
+    for (auto &label : {run_from, run_to}) {
+      if (!label.empty() && std::find(flow_stages.begin(), flow_stages.end(),
+                                      label) == flow_stages.end()) {
+        log_cmd_error("Unknown stage '%s' in -run option.\n", label.c_str());
+      }
+    }
+
+    if ((hier_jobs > 0) && !no_flatten) {
+      log_cmd_error("-hier_jobs requires -no_flatten.\n");
+    }
+
+    // Options forwarded to the per-module 'synth_fpga' workers of the
+    // hierarchical mode.
+    //
+    for (size_t i = 1; i < argidx; i++) {
+      if (args[i] == "-top" || args[i] == "-hier_jobs" || args[i] == "-run" ||
+          args[i] == "-checkpoint_dir" || args[i] == "-trace" ||
+          args[i] == "-verilog" || args[i] == "-config" ||
+          args[i] == "-abc_cache") {
+        i++;
+        continue;
+      }
+      if (args[i] == "-csv" || args[i] == "-wait" ||
+          args[i] == "-show_config" || args[i] == "-show_max_level") {
+        continue;
+      }
+      hier_options += " " + args[i];
+    }
+    if (!config_file.empty()) {
+      hier_options += " -config " +
+          zjob_quote(std::filesystem::absolute(config_file).string());
+    }
+    if (!abc_cache_dir.empty()) {
+      hier_options += " -abc_cache " +
+          zjob_quote(std::filesystem::absolute(abc_cache_dir).string());
+    }
+
+    // Options changing the synthesis result are part of the checkpoint key.
+    //
+    for (size_t i = 1; i < argidx; i++) {
+      if (args[i] == "-run" || args[i] == "-checkpoint_dir" ||
+          args[i] == "-trace" || args[i] == "-abc_cache" ||
+          args[i] == "-abc_cache_size") {
+        i++;
+        continue;
+      }
+      if (args[i] == "-wait" || args[i] == "-verbose") {
+        continue;
+      }
+      checkpoint_options += " " + args[i];
+    }
+
     log_header(design, "Executing Zero Asic 'synth_fpga' flow.\n");
     log_push();
 
+    // The design stats are attached for the run only, unless they already
+    // were (ex: 'design_stats -attach').
+    //
+    bool own_stats = !DesignStats::find(design);
+
     run_script(design, run_from, run_to);
 
+    if (own_stats) {
+      DesignStats::release(design);
+    }
+
     log_pop();
   }
 
@@ -3472,6 +5248,9 @@ struct SynthFpgaPass : public ScriptPass {
 
     auto startTime = std::chrono::high_resolution_clock::now();
 
+    trace_events.clear();
+    trace_start_time = startTime;
+
     log("\nPLATYPUS flow using 'synth_fpga' Yosys plugin command\n");
 
     log("'Zero Asic' FPGA Synthesis Version : %s\n", SYNTH_FPGA_VERSION);
@@ -3493,22 +5272,48 @@ struct SynthFpgaPass : public ScriptPass {
     //
     check_options();
 
-    // Check hierarchy and find the TOP
+    // Checkpoints are keyed on the input design, so compute the key before
+    // the design gets modified, then eventually restore the checkpoint to
+    // start from in case of '-run <from>:<to>'.
     //
-    run(stringf("hierarchy %s", help_mode ? "-top <top>" : top_opt.c_str()));
+    if (!checkpoint_dir.empty() && !help_mode) {
+      checkpoint_key = compute_checkpoint_key();
+      log("\n   Checkpoint key : %s\n", checkpoint_key.c_str());
+      resume_from_checkpoint();
+    }
 
-    // This is useful to load non-lut cells models in case we are doing a
-    // resynthesis, e.g when the input design is a previous synthesized
-    // netlist which has been synthesized with 'synth_fpga'.
-    //
+    if (check_label("begin")) {
 
-    if(config_file == "") {
-      load_hardcoded_cell_models();
-    }
-    else {
-      load_cell_models_from_config();
-    }
+      // Check hierarchy and find the TOP
+      //
+      run(stringf("hierarchy %s", help_mode ? "-top <top>" : top_opt.c_str()));
+
+      // This is useful to load non-lut cells models in case we are doing a
+      // resynthesis, e.g when the input design is a previous synthesized
+      // netlist which has been synthesized with 'synth_fpga'.
+      //
+
+      pool<IdString> rtl_modules;
+      for (auto module : yosys_get_design()->modules()) {
+        rtl_modules.insert(module->name);
+      }
+
+      if(config_file == "") {
+        load_hardcoded_cell_models();
+      }
+      else {
+        load_cell_models_from_config();
+      }
+
+      for (auto module : yosys_get_design()->modules()) {
+        if (!rtl_modules.count(module->name)) {
+          model_modules.insert(module->name);
+        }
+      }
+      model_modules_known = true;
 
+      save_checkpoint("begin");
+    }
 
     // In case user invokes the '-resynthesis' option at the command line level,
     // we perform a light weight synthesis for the second time.
@@ -3517,281 +5322,345 @@ struct SynthFpgaPass : public ScriptPass {
 
       resynthesize();
 
+      end_trace();
+
       return;
     }
 
-    // --------------------------------------------------------
-    // Otherwise we start the Main Synthesis flow right here.
+    // Hierarchical mode : the 'coarse' to 'abc' stages are run per unique
+    // module by separate processes.
     //
-    run("proc");
+    bool hier_done = false;
 
-    dbg_wait();
+    if (no_flatten && (hier_jobs > 0) && !help_mode &&
+        check_label("coarse")) {
 
-    if (!no_flatten) {
-      run("flatten");
+      hier_done = synthesize_hierarchy();
+
+      if (hier_done) {
+        save_checkpoint("abc");
+      }
     }
 
-    // Note there are two possibilities for how macro mapping might be done:
-    // using the extract command (to pattern match user RTL against
-    // the techmap) or using the techmap command.  The latter is better
-    // for mapping simple multipliers; the former is better (for now)
-    // for mapping more complex DSP blocks (MAC, pipelined blocks, etc).
-    // and is also more easily extensible to arbitrary hard macros.
-    // Run separate passes of both to get best of both worlds
+    if (!hier_done && check_label("coarse")) {
 
-    // An extract pass needs to happen prior to other optimizations,
-    // otherwise yosys can transform its internal model into something
-    // that doesn't match the patterns defined in the extract library
+      // --------------------------------------------------------
+      // Otherwise we start the Main Synthesis flow right here.
+      //
+      run("proc");
 
-    // Other hard macro passes can happen after the generic optimization
-    // passes take place.
+      dbg_wait();
 
-    // Generic optimization passes; this is a fusion of the VTR reference
-    // flow and the Yosys synth_ice40 flow
-    //
-    coarse_synthesis();
+      if (!no_flatten) {
+        run("flatten");
+        recount_stats();
+      }
 
-    run("stat");
+      // Note there are two possibilities for how macro mapping might be done:
+      // using the extract command (to pattern match user RTL against
+      // the techmap) or using the techmap command.  The latter is better
+      // for mapping simple multipliers; the former is better (for now)
+      // for mapping more complex DSP blocks (MAC, pipelined blocks, etc).
+      // and is also more easily extensible to arbitrary hard macros.
+      // Run separate passes of both to get best of both worlds
 
-    dbg_wait();
+      // An extract pass needs to happen prior to other optimizations,
+      // otherwise yosys can transform its internal model into something
+      // that doesn't match the patterns defined in the extract library
 
-    // Here is a remaining customization pass for DSP tech mapping
-    // Map DSP blocks before doing anything else,
-    // so that we don't convert any math blocks
-    // into other primitives
-    //
-    // Map DSP components
-    //
-    infer_DSPs();
+      // Other hard macro passes can happen after the generic optimization
+      // passes take place.
 
-    // Mimic ICE40 flow by running an alumacc and memory -nomap passes
-    // after DSP mapping
-    //
-    run("alumacc");
-    run("opt");
-    run("memory -nomap");
+      // Generic optimization passes; this is a fusion of the VTR reference
+      // flow and the Yosys synth_ice40 flow
+      //
+      coarse_synthesis();
 
-    // First strategy : we deeply optimize logic but we may break its
-    // nice structure than can map in nice DFF enable
-    // (ex: big_designs/VexRiscv).
-    // But it may help for some designs (ex: medium_designs/xtea)
-    //
-    run("opt -full");
+      show_stat();
 
-    // Move parallel muxes into shifters. This needs to be re-investigated
-    // because it looks that we may not be optimal here (see 'reg2file'
-    // testcase where we are behind competition) and this is probably due
-    // to not handling efficiently parallel case.
-    //
-    run("pmux2shiftx");
+      dbg_wait();
 
-    run("techmap -map +/techmap.v");
+      save_checkpoint("coarse");
+    }
 
-    // BRAM inference
-    //
-    infer_BRAMs();
+    if (!hier_done && check_label("dsp")) {
 
-    // After doing memory mapping, turn any remaining
-    // $mem_v2 instances into flop arrays
-    //
-    run("memory_map");
+      // Here is a remaining customization pass for DSP tech mapping
+      // Map DSP blocks before doing anything else,
+      // so that we don't convert any math blocks
+      // into other primitives
+      //
+      // Map DSP components
+      //
+      infer_DSPs();
+
+      // Mimic ICE40 flow by running an alumacc and memory -nomap passes
+      // after DSP mapping
+      //
+      run("alumacc");
+      run("opt");
+      run("memory -nomap");
+
+      // First strategy : we deeply optimize logic but we may break its
+      // nice structure than can map in nice DFF enable
+      // (ex: big_designs/VexRiscv).
+      // But it may help for some designs (ex: medium_designs/xtea)
+      //
+      run("opt -full");
 
-    run("demuxmap");
-    run("simplemap");
+      // Move parallel muxes into shifters. This needs to be re-investigated
+      // because it looks that we may not be optimal here (see 'reg2file'
+      // testcase where we are behind competition) and this is probably due
+      // to not handling efficiently parallel case.
+      //
+      run("pmux2shiftx");
 
-    // Show dff init values if requested and eventually set init values to 0
-    // for both DFF with un-initialized Values and DFF with init value 1.
-    //
-    if (set_dff_init_value_to_zero || show_dff_init_value) {
+      run("techmap -map +/techmap.v");
 
-      processDffInitValues(set_dff_init_value_to_zero);
+      save_checkpoint("dsp");
     }
 
-    // Make sure we have no LATCH otherwise eventually error out depending on
-    // the command line option '-continue_if_latch'.
-    //
-    check_DLatch();
+    if (!hier_done && check_label("bram")) {
 
-    // Try to detect stuck-at DFF either through SAT solver or constant
-    // detection at DFF inputs.
-    //
-    optimize_DFFs();
+      // BRAM inference
+      //
+      infer_BRAMs();
 
-    run("techmap");
+      // After doing memory mapping, turn any remaining
+      // $mem_v2 instances into flop arrays
+      //
+      run("memory_map");
 
-    // Performs 'opt' pass with light weight version for HUGE designs.
-    //
-    if (getNumberOfCells() <= HUGE_NB_CELLS) {
+      run("demuxmap");
+      run("simplemap");
 
-      run("opt -full");
+      save_checkpoint("bram");
+    }
 
-    } else {
+    if (!hier_done && check_label("dff_opt")) {
 
-      run("opt_expr");
-      run("opt_clean");
-    }
+      // Show dff init values if requested and eventually set init values to 0
+      // for both DFF with un-initialized Values and DFF with init value 1.
+      //
+      if (set_dff_init_value_to_zero || show_dff_init_value) {
 
-    // Transform Yosys generic DFF into target technology supported ones.
-    //
-    legalize_flops();
+        processDffInitValues(set_dff_init_value_to_zero);
+      }
 
-    if (getNumberOfCells() <= HUGE_NB_CELLS) {
+      // Make sure we have no LATCH otherwise eventually error out depending on
+      // the command line option '-continue_if_latch'.
+      //
+      check_DLatch();
 
-      run("opt -full");
-      legalize_flops(); // run dfflegalize again in case opt -full introduces unsupported FF types 
+      // Try to detect stuck-at DFF either through SAT solver or constant
+      // detection at DFF inputs.
+      //
+      optimize_DFFs();
 
-    } else {
+      run("techmap");
 
-      run("opt_expr");
-      run("opt_clean");
+      // Performs 'opt' pass with light weight version for HUGE designs.
+      //
+      if (getNumberOfCells() <= HUGE_NB_CELLS) {
+
+        run("opt -full");
+
+      } else {
+
+        run("opt_expr");
+        run("opt_clean");
+      }
+
+      save_checkpoint("dff_opt");
     }
 
-    // Map on the DFF of the architecture (partname)
-    //
-    string sc_syn_flop_library = ys_dff_techmap;
-    run("techmap -map " + sc_syn_flop_library);
+    if (!hier_done && check_label("legalize")) {
 
-    // 'post_techmap' without arguments gives the following
-    // according to '.../siliconcompiler/tools/yosys/procs.tcl'
-    //
-    run("techmap");
+      // Transform Yosys generic DFF into target technology supported ones.
+      //
+      legalize_flops();
 
-    // Performs 'opt' pass with lightweight version for HUGE designs.
-    //
-    if (getNumberOfCells() <= HUGE_NB_CELLS) {
+      if (getNumberOfCells() <= HUGE_NB_CELLS) {
 
-      run("opt -purge");
+        run("opt -full");
+        legalize_flops(); // run dfflegalize again in case opt -full introduces unsupported FF types 
 
-    } else {
+      } else {
 
-      run("opt_expr");
-      run("opt_clean");
-    }
+        run("opt_expr");
+        run("opt_clean");
+      }
 
-    // Perform preliminary buffer insertion before passing to ABC to help reduce
-    // the overhead of final buffer insertion downstream
-    //
-    if (insbuf) {
-      run("insbuf");
-    }
+      // Map on the DFF of the architecture (partname)
+      //
+      string sc_syn_flop_library = ys_dff_techmap;
+      run("techmap -map " + sc_syn_flop_library);
 
-    run("stat");
+      // 'post_techmap' without arguments gives the following
+      // according to '.../siliconcompiler/tools/yosys/procs.tcl'
+      //
+      run("techmap");
 
-    dbg_wait();
+      // Performs 'opt' pass with lightweight version for HUGE designs.
+      //
+      if (getNumberOfCells() <= HUGE_NB_CELLS) {
 
-    // Binarize long XOR tree chains in delay mode. Typical example is
-    // 'gray2bin' in 'logikbench/basic' suite having 64 levels that can be
-    // reduced to 6 levels. We still lose in area a little bit versus
-    // competition (166 vs 134).
-    //
-    if (!no_xor_tree_process && (opt == "delay")) {
+        run("opt -purge");
 
-      binary_decomp_xor_trees(yosys_get_design()->top_module());
-    }
+      } else {
 
-    run("stat");
+        run("opt_expr");
+        run("opt_clean");
+      }
 
-    // Optimize and map through ABC the combinational logic part of the design.
-    //
-    abc_synthesize();
+      // Perform preliminary buffer insertion before passing to ABC to help reduce
+      // the overhead of final buffer insertion downstream
+      //
+      if (insbuf) {
+        run("insbuf");
+      }
 
-    run("stat");
+      show_stat();
 
-    dbg_wait();
+      dbg_wait();
 
-    run("splitcells");
+      save_checkpoint("legalize");
+    }
 
-    run("splitnets");
+    if (!hier_done && check_label("abc")) {
 
-    // remove dangling logic. Eventually call 'obs_clean' if option is
-    // activated.
-    //
-    clean_design();
+      // Binarize long XOR tree chains in delay mode. Typical example is
+      // 'gray2bin' in 'logikbench/basic' suite having 64 levels that can be
+      // reduced to 6 levels. We still lose in area a little bit versus
+      // competition (166 vs 134).
+      //
+      if (!no_xor_tree_process && (opt == "delay")) {
 
-    dbg_wait();
+        binary_decomp_xor_trees(yosys_get_design()->top_module());
+      }
 
-    run("opt_lut_ins");
-    run("opt_lut");
+      show_stat();
 
-    run("setundef -zero");
-    run("clean -purge");
+      // Optimize and map through ABC the combinational logic part of the design.
+      //
+      abc_synthesize();
 
-    // Look for undriven nets and eventually error out if it happens to
-    // avoid to error out way later in the P&R steps.
-    //
-    analyze_undriven_nets(yosys_get_design()->top_module(),
-                          true /* connect undriven nets to undef */);
+      show_stat();
 
-    // tries to give public names instead of using $abc generic names.
-    // Right now this procedure blows up runtime for medium/big designs.
-    // This 'autoname' procedure needs to be re-written to be efficient.
-    //
-    if (autoname) {
-      run("autoname");
+      dbg_wait();
+
+      save_checkpoint("abc");
     }
 
-    if (!verilog_file.empty()) {
+    if (check_label("cleanup")) {
+
+      run("splitcells");
 
-      log("Dump Verilog file '%s'\n", verilog_file.c_str());
-      run(stringf("write_verilog -noexpr -nohex -nodec %s",
-                  verilog_file.c_str()));
+      run("splitnets");
 
-    } else { // Still dump verilog under the hood for debug/analysis reasons.
+      // remove dangling logic. Eventually call 'obs_clean' if option is
+      // activated.
+      //
+      clean_design();
 
-      run(stringf("write_verilog -noexpr -nohex -nodec %s",
-                  "netlist_synth_fpga.verilog"));
-    }
+      dbg_wait();
 
-    // ==========================
-    // Show final report
-    //
-    auto endTime = std::chrono::high_resolution_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
-        endTime - startTime);
+      run("opt_lut_ins");
+      run("opt_lut");
 
-    float totalTime = 1 + elapsed.count() * 1e-9;
+      run("setundef -zero");
+      run("clean -purge");
 
-    if(config_file == ""){
-      log("   PartName   : %s\n", part_name.c_str());
-    }
-    else {
-      log("   PartName   : %s\n", G_config.partname.c_str());
+      // Look for undriven nets and eventually error out if it happens to
+      // avoid to error out way later in the P&R steps.
+      //
+      analyze_undriven_nets(yosys_get_design()->top_module(),
+                            true /* connect undriven nets to undef */);
+
+      // tries to give public names instead of using $abc generic names.
+      // Right now this procedure blows up runtime for medium/big designs.
+      // This 'autoname' procedure needs to be re-written to be efficient.
+      //
+      if (autoname) {
+        run("autoname");
+      }
+
+      if (!verilog_file.empty()) {
+
+        log("Dump Verilog file '%s'\n", verilog_file.c_str());
+        run(stringf("write_verilog -noexpr -nohex -nodec %s",
+                    verilog_file.c_str()));
+
+      } else { // Still dump verilog under the hood for debug/analysis reasons.
+
+        run(stringf("write_verilog -noexpr -nohex -nodec %s",
+                    "netlist_synth_fpga.verilog"));
+      }
+
+      save_checkpoint("cleanup");
     }
-    log("   DSP Style  : %s\n", dsp_tech.c_str());
-    log("   BRAM Style : %s\n", bram_tech.c_str());
-    log("   OPT target : %s\n", opt.c_str());
-    log("\n");
-    log("   'Zero Asic' FPGA Synthesis Version : %s\n", SYNTH_FPGA_VERSION);
-    log("\n");
-    log("   Total Synthesis Run Time = %.1f sec.\n", totalTime);
 
-    // Show longest path in 'delay' mode
-    //
-    if ((opt == "delay") || show_max_level) {
+    if (check_label("report")) {
 
-      // show max logic level between clock edge triggered cells end points.
+      // ==========================
+      // Show final report
       //
-      run("max_level -clk2clk"); // -> store 'maxlvl' in scratchpad with
-                                 // 'max_level.max_levels'
+      auto endTime = std::chrono::high_resolution_clock::now();
+      auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          endTime - startTime);
+
+      float totalTime = 1 + elapsed.count() * 1e-9;
+
+      if(config_file == ""){
+        log("   PartName   : %s\n", part_name.c_str());
+      }
+      else {
+        log("   PartName   : %s\n", G_config.partname.c_str());
+      }
+      log("   DSP Style  : %s\n", dsp_tech.c_str());
+      log("   BRAM Style : %s\n", bram_tech.c_str());
+      log("   OPT target : %s\n", opt.c_str());
+      log("\n");
+      log("   'Zero Asic' FPGA Synthesis Version : %s\n", SYNTH_FPGA_VERSION);
+      log("\n");
+      log("   Total Synthesis Run Time = %.1f sec.\n", totalTime);
 
-      // Show LUTs logic max height (that we get also in ABC synthesis)
+      // Show longest path in 'delay' mode
       //
-      run("max_height"); // -> store 'maxheight' in scratchpad with
-                         // 'max_height.max_height'
-    }
+      if ((opt == "delay") || show_max_level) {
+
+        // show max logic level between clock edge triggered cells end points.
+        //
+        run("max_level -clk2clk"); // -> store 'maxlvl' in scratchpad with
+                                   // 'max_level.max_levels'
+
+        // Arrival times and slacks with the 'timing' section delays
+        //
+        if (config_file_success && G_config.has_timing) {
+          run("max_level -clk2clk -summary -delays " + config_file);
+        }
+
+        // Show LUTs logic max height (that we get also in ABC synthesis)
+        //
+        run("max_height"); // -> store 'maxheight' in scratchpad with
+                           // 'max_height.max_height'
+      }
 
-    run("stat");
+      show_stat(true /* show_types */);
 
-    // ==========================
+      // ==========================
 
-    if (csv) {
-      dump_csv_file("stat.csv", (int)totalTime);
+      if (csv) {
+        dump_csv_file("stat.csv", (int)totalTime);
+      }
+
+      // Error out if illegal cells are in the netlist instead of erroring out
+      // in P&R.
+      //
+      check_illegal_cells();
     }
 
-    // Error out if illegal cells are in the netlist instead of erroring out
-    // in P&R.
-    //
-    check_illegal_cells();
+    end_trace();
 
     log("\n");
     log(" ----------------------------\n");
@@ -0,0 +1,1124 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+
+#include "timing_graph.h"
+#include "kernel/log.h"
+#include <atomic>
+#include <queue>
+#include <thread>
+
+YOSYS_NAMESPACE_BEGIN
+
+// -------------------------
+// parallel_for
+// -------------------------
+// Call 'fn(thread, begin, end)' on contiguous chunks of [0, size), in the
+// calling thread only if 'size' is below 'min_size'.
+//
+static void parallel_for(int nb_threads, int size, int min_size,
+                         const std::function<void(int, int, int)> &fn) {
+  if ((nb_threads <= 1) || (size < min_size)) {
+    fn(0, 0, size);
+    return;
+  }
+
+  int chunk = (size + nb_threads - 1) / nb_threads;
+
+  vector<std::thread> threads;
+
+  for (int t = 0; t < nb_threads; t++) {
+
+    int begin = t * chunk;
+    int end = std::min(size, begin + chunk);
+
+    if (begin >= end) {
+      break;
+    }
+
+    threads.emplace_back(fn, t, begin, end);
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// -------------------------
+// TimingGraph::compute_arrivals
+// -------------------------
+// Latest arrival over the fanins, in topological order. Unit delays when
+// no 'arc_delay' is set.
+//
+void TimingGraph::compute_arrivals(const dict<int, float> &source_arrival) {
+  int nb = nb_nodes();
+
+  vector<int> position(nb);
+
+  for (int i = 0; i < GetSize(order); i++) {
+    position[order[i]] = i;
+  }
+
+  arrival.assign(nb, 0);
+  arrival_from.assign(nb, -1);
+  arrival_driver.assign(nb, -1);
+
+  for (auto &it : source_arrival) {
+    arrival[it.first] = it.second;
+  }
+
+  for (int n : order) {
+
+    for (int i = fanin_start[n]; i < fanin_start[n + 1]; i++) {
+
+      int fanin = fanin_node[i];
+
+      if (position[fanin] >= position[n]) {
+        continue;
+      }
+
+      float at = arrival[fanin] + (fanin_delay.empty() ? 1 : fanin_delay[i]);
+
+      if ((arrival_from[n] < 0) || (at > arrival[n])) {
+        arrival[n] = at;
+        arrival_from[n] = fanin;
+        arrival_driver[n] = fanin_cell[i];
+      }
+    }
+  }
+}
+
+// -------------------------
+// TimingGraph::compute_required
+// -------------------------
+// Min over the fanouts of their required height minus one, in reverse
+// topological order.
+//
+void TimingGraph::compute_required(int target) {
+  int nb = nb_nodes();
+
+  vector<int> position(nb);
+
+  for (int i = 0; i < GetSize(order); i++) {
+    position[order[i]] = i;
+  }
+
+  required.assign(nb, target);
+
+  for (int i = GetSize(order) - 1; i >= 0; i--) {
+
+    int n = order[i];
+
+    for (int j = fanout_start[n]; j < fanout_start[n + 1]; j++) {
+
+      int fanout = fanout_node[j];
+
+      if (position[fanout] <= i) {
+        continue;
+      }
+
+      required[n] = std::min(required[n], required[fanout] - 1);
+    }
+  }
+}
+
+// -------------------------
+// get_nb_threads
+// -------------------------
+int get_nb_threads(const std::string &arg) {
+  int nb = atoi(arg.c_str());
+
+  if (nb < 0) {
+    log_cmd_error("Invalid thread count '%s'.\n", arg.c_str());
+  }
+
+  if (nb == 0) {
+    nb = std::max(1, (int)std::thread::hardware_concurrency());
+  }
+
+  return nb;
+}
+
+// -------------------------
+// TimingGraph::add_node
+// -------------------------
+int TimingGraph::add_node(RTLIL::SigBit bit) {
+  bit2node[bit] = GetSize(bits);
+  bits.push_back(bit);
+  is_const.push_back(bit.wire == nullptr);
+  return GetSize(bits) - 1;
+}
+
+// -------------------------
+// TimingGraph::add_cell
+// -------------------------
+// Add the edges from the input bits to the output bits of 'cell'.
+//
+void TimingGraph::add_cell(RTLIL::Cell *cell, SigMap &sigmap) {
+  pool<int> src_nodes, dst_nodes;
+  vector<pair<int, RTLIL::IdString>> src_ports, dst_ports;
+
+  for (auto &conn : cell->connections()) {
+
+    bool is_input = cell->input(conn.first);
+    bool is_output = cell->output(conn.first);
+
+    for (auto bit : sigmap(conn.second)) {
+
+      int n = node(bit);
+
+      if (n < 0) {
+        if (!with_constants && !bit.wire) {
+          continue;
+        }
+        n = add_node(bit);
+      }
+
+      if (is_input) {
+        src_nodes.insert(n);
+        src_ports.push_back({n, conn.first});
+      }
+      if (is_output) {
+        dst_nodes.insert(n);
+        dst_ports.push_back({n, conn.first});
+      }
+    }
+  }
+
+  if (src_nodes.empty() || dst_nodes.empty()) {
+    return;
+  }
+
+  // Edge delays : max over the port pairs of each (src, dst) nodes.
+  //
+  dict<pair<int, int>, float> delays;
+
+  if (arc_delay) {
+
+    dict<pair<RTLIL::IdString, RTLIL::IdString>, float> port_delays;
+
+    for (auto &src : src_ports) {
+      for (auto &dst : dst_ports) {
+
+        auto ports = std::make_pair(src.second, dst.second);
+
+        if (!port_delays.count(ports)) {
+          port_delays[ports] = arc_delay(cell, src.second, dst.second);
+        }
+
+        auto key = std::make_pair(src.first, dst.first);
+        float delay = port_delays.at(ports);
+
+        if (!delays.count(key) || (delays.at(key) < delay)) {
+          delays[key] = delay;
+        }
+      }
+    }
+  }
+
+  int cell_idx = GetSize(cells);
+  cells.push_back(cell);
+  cell2idx[cell] = cell_idx;
+  cell_edges.push_back({GetSize(edge_src), 0});
+
+  for (int s : src_nodes) {
+    for (int d : dst_nodes) {
+      edge_src.push_back(s);
+      edge_dst.push_back(d);
+      edge_cell.push_back(cell_idx);
+
+      if (arc_delay) {
+        edge_delay.push_back(delays.at({s, d}));
+      }
+    }
+  }
+
+  cell_edges.back().second = GetSize(edge_src);
+}
+
+// -------------------------
+// TimingGraph::build
+// -------------------------
+// Edges are collected in one pass over the cells, then sorted by
+// destination and by source (counting sort) into the two CSR tables.
+//
+void TimingGraph::build(RTLIL::Module *module, SigMap &sigmap,
+                        const std::function<bool(RTLIL::Cell *)> &traversable,
+                        bool with_constants) {
+  this->module = module;
+  this->with_constants = with_constants;
+
+  min_parallel_nodes = module->design->scratchpad_get_int(
+      "timing_graph.min_parallel_nodes", TIMING_GRAPH_MIN_PARALLEL_NODES);
+
+  bits.clear();
+  bit2node.clear();
+  is_const.clear();
+  cells.clear();
+  cell2idx.clear();
+  cell_edges.clear();
+  edge_src.clear();
+  edge_dst.clear();
+  edge_cell.clear();
+  edge_delay.clear();
+  order.clear();
+  wave_start.clear();
+
+  for (auto wire : module->selected_wires()) {
+    for (auto bit : sigmap(wire)) {
+      if (!bit2node.count(bit)) {
+        add_node(bit);
+      }
+    }
+  }
+
+  for (auto cell : module->selected_cells()) {
+    if (traversable(cell)) {
+      add_cell(cell, sigmap);
+    }
+  }
+
+  pack();
+
+  int nb = nb_nodes();
+
+  level.assign(nb, -1);
+  from.assign(nb, -1);
+  driver.assign(nb, -1);
+  height.assign(nb, -1);
+}
+
+// -------------------------
+// TimingGraph::pack
+// -------------------------
+// Fill the CSR tables from the edges of the cells still in the graph.
+//
+void TimingGraph::pack() {
+  int nb = nb_nodes();
+
+  fanin_start.assign(nb + 1, 0);
+  fanout_start.assign(nb + 1, 0);
+
+  for (int e = 0; e < GetSize(edge_src); e++) {
+    if (cells[edge_cell[e]]) {
+      fanin_start[edge_dst[e] + 1]++;
+      fanout_start[edge_src[e] + 1]++;
+    }
+  }
+
+  for (int n = 0; n < nb; n++) {
+    fanin_start[n + 1] += fanin_start[n];
+    fanout_start[n + 1] += fanout_start[n];
+  }
+
+  int nb_edges = fanin_start[nb];
+
+  fanin_node.resize(nb_edges);
+  fanin_cell.resize(nb_edges);
+  fanout_node.resize(nb_edges);
+  fanin_delay.resize(edge_delay.empty() ? 0 : nb_edges);
+
+  vector<int> fanin_pos(fanin_start.begin(), fanin_start.end() - 1);
+  vector<int> fanout_pos(fanout_start.begin(), fanout_start.end() - 1);
+
+  for (int e = 0; e < GetSize(edge_src); e++) {
+
+    if (!cells[edge_cell[e]]) {
+      continue;
+    }
+
+    int i = fanin_pos[edge_dst[e]]++;
+    fanin_node[i] = edge_src[e];
+    fanin_cell[i] = edge_cell[e];
+    if (!edge_delay.empty()) {
+      fanin_delay[i] = edge_delay[e];
+    }
+    fanout_node[fanout_pos[edge_src[e]]++] = edge_dst[e];
+  }
+}
+
+// -------------------------
+// TimingGraph::update
+// -------------------------
+// The edges of the changed cells are dropped and those of the cells still
+// in the module are added back. Only the levels of the nodes driven by
+// these cells, and of their fanouts when they change, are recomputed.
+//
+void TimingGraph::update(SigMap &sigmap,
+                         const dict<RTLIL::Cell *, bool> &changed,
+                         const std::function<bool(RTLIL::Cell *)> &traversable,
+                         int nb_threads) {
+  vector<int> seeds;
+
+  for (auto &it : changed) {
+
+    // A removed cell pointer is only used as a key.
+    //
+    auto idx_it = cell2idx.find(it.first);
+
+    if (idx_it != cell2idx.end()) {
+
+      int idx = idx_it->second;
+
+      for (int e = cell_edges[idx].first; e < cell_edges[idx].second; e++) {
+        seeds.push_back(edge_dst[e]);
+      }
+
+      cells[idx] = nullptr;
+      cell2idx.erase(idx_it);
+    }
+
+    RTLIL::Cell *cell = it.first;
+
+    if (!it.second || !traversable(cell)) {
+      continue;
+    }
+
+    int first_edge = GetSize(edge_src);
+
+    add_cell(cell, sigmap);
+
+    for (int e = first_edge; e < GetSize(edge_src); e++) {
+      seeds.push_back(edge_dst[e]);
+    }
+  }
+
+  pack();
+
+  int nb = nb_nodes();
+
+  level.resize(nb, 0);
+  from.resize(nb, -1);
+  driver.resize(nb, -1);
+  height.resize(nb, -1);
+
+  if (has_loops || !relevel(seeds)) {
+    levelize(nb_threads);
+    return;
+  }
+
+  // Nodes sorted by level are in topological order, each level being a
+  // wave.
+  //
+  int max_level = 0;
+
+  for (int n = 0; n < nb; n++) {
+    max_level = std::max(max_level, level[n]);
+  }
+
+  wave_start.assign(max_level + 2, 0);
+
+  for (int n = 0; n < nb; n++) {
+    wave_start[level[n] + 1]++;
+  }
+
+  for (int l = 0; l <= max_level; l++) {
+    wave_start[l + 1] += wave_start[l];
+  }
+
+  vector<int> pos(wave_start.begin(), wave_start.end() - 1);
+
+  order.resize(nb);
+
+  for (int n = 0; n < nb; n++) {
+    order[pos[level[n]]++] = n;
+  }
+}
+
+// -------------------------
+// TimingGraph::relevel
+// -------------------------
+// Pull the levels of the 'seeds' and push the nodes whose level changed to
+// their fanouts, lower levels first. Return false on a loop, or when more
+// nodes are pulled than a full 'levelize' would visit : a loop created by
+// the changes would otherwise only show up once a level reaches the number
+// of nodes.
+//
+bool TimingGraph::relevel(const vector<int> &seeds) {
+  int nb = nb_nodes();
+  int budget = nb;
+
+  std::priority_queue<pair<int, int>, vector<pair<int, int>>,
+                      std::greater<pair<int, int>>>
+      queue;
+  vector<bool> queued(nb, false);
+
+  for (int n : seeds) {
+    if (!queued[n]) {
+      queued[n] = true;
+      queue.push({level[n], n});
+    }
+  }
+
+  while (!queue.empty()) {
+
+    int n = queue.top().second;
+    queue.pop();
+    queued[n] = false;
+
+    if (--budget < 0) {
+      return false;
+    }
+
+    int old_level = level[n];
+
+    pull_level(n, nullptr);
+
+    if (level[n] >= nb) {
+      return false;
+    }
+
+    if (level[n] == old_level) {
+      continue;
+    }
+
+    for (int i = fanout_start[n]; i < fanout_start[n + 1]; i++) {
+
+      int fanout = fanout_node[i];
+
+      if (!queued[fanout]) {
+        queued[fanout] = true;
+        queue.push({level[fanout], fanout});
+      }
+    }
+  }
+
+  return true;
+}
+
+// -------------------------
+// TimingGraph::pull_level
+// -------------------------
+// Only the 'done' fanins are considered, all of them if 'done' is null.
+//
+void TimingGraph::pull_level(int n, const vector<bool> *done) {
+  int n_level = 0;
+  int n_from = -1;
+  int n_driver = -1;
+
+  for (int i = fanin_start[n]; i < fanin_start[n + 1]; i++) {
+
+    int fanin = fanin_node[i];
+
+    if ((!done || (*done)[fanin]) && (level[fanin] + 1 > n_level)) {
+      n_level = level[fanin] + 1;
+      n_from = fanin;
+      n_driver = fanin_cell[i];
+    }
+  }
+
+  level[n] = n_level;
+  from[n] = n_from;
+  driver[n] = n_driver;
+}
+
+// -------------------------
+// TimingGraph::levelize_waves
+// -------------------------
+// Kahn traversal one wave at a time. All the fanins of a wave node are in
+// the previous waves so the nodes of a wave are independent : their
+// levels are pulled, then their fanouts released, concurrently. The waves
+// are sorted so that 'order' does not depend on the thread timing.
+//
+// Return false, with nothing levelized, when stuck on a loop.
+//
+bool TimingGraph::levelize_waves(int nb_threads) {
+  int nb = nb_nodes();
+
+  vector<std::atomic<int>> nb_pending(nb);
+  vector<int> wave;
+
+  for (int n = 0; n < nb; n++) {
+    nb_pending[n].store(nb_fanins(n), std::memory_order_relaxed);
+    if (nb_fanins(n) == 0) {
+      wave.push_back(n);
+    }
+  }
+
+  order.clear();
+  order.reserve(nb);
+  wave_start.clear();
+
+  vector<vector<int>> next_waves(nb_threads);
+
+  while (!wave.empty()) {
+
+    wave_start.push_back(GetSize(order));
+    order.insert(order.end(), wave.begin(), wave.end());
+
+    parallel_for(nb_threads, GetSize(wave), min_parallel_nodes,
+                 [&](int, int begin, int end) {
+                   for (int i = begin; i < end; i++) {
+                     pull_level(wave[i], nullptr);
+                   }
+                 });
+
+    parallel_for(
+        nb_threads, GetSize(wave), min_parallel_nodes,
+        [&](int t, int begin, int end) {
+          for (int i = begin; i < end; i++) {
+
+            int n = wave[i];
+
+            for (int j = fanout_start[n]; j < fanout_start[n + 1]; j++) {
+
+              int fanout = fanout_node[j];
+
+              if (nb_pending[fanout].fetch_sub(
+                      1, std::memory_order_relaxed) == 1) {
+                next_waves[t].push_back(fanout);
+              }
+            }
+          }
+        });
+
+    wave.clear();
+
+    for (auto &next_wave : next_waves) {
+      wave.insert(wave.end(), next_wave.begin(), next_wave.end());
+      next_wave.clear();
+    }
+
+    std::sort(wave.begin(), wave.end());
+  }
+
+  wave_start.push_back(GetSize(order));
+
+  if (GetSize(order) < nb) {
+    order.clear();
+    wave_start.clear();
+    return false;
+  }
+
+  has_loops = false;
+
+  return true;
+}
+
+// -------------------------
+// TimingGraph::levelize
+// -------------------------
+// Kahn traversal : a node is processed once all its fanins are, its level
+// being pulled from them. When only nodes on loops are left, one of them is
+// released and the loop is cut there.
+//
+void TimingGraph::levelize(int nb_threads) {
+  find_loops();
+
+  has_loops = !loops.empty();
+
+  if (has_loops) {
+    report_loops();
+  } else if ((nb_threads > 1) && levelize_waves(nb_threads)) {
+    return;
+  }
+
+  int nb = nb_nodes();
+
+  vector<int> nb_pending(nb);
+  vector<bool> done(nb, false);
+  vector<bool> is_cut(nb, false);
+  vector<int> ready;
+
+  for (int n = 0; n < nb; n++) {
+    nb_pending[n] = nb_fanins(n);
+  }
+
+  // The fanins of a cut node in its own loop are not waited for.
+  //
+  for (int cut : loop_cut) {
+
+    is_cut[cut] = true;
+
+    for (int i = fanin_start[cut]; i < fanin_start[cut + 1]; i++) {
+      if (loop_id[fanin_node[i]] == loop_id[cut]) {
+        nb_pending[cut]--;
+      }
+    }
+  }
+
+  for (int n = 0; n < nb; n++) {
+    if (nb_pending[n] == 0) {
+      ready.push_back(n);
+    }
+  }
+
+  // Pop the sources in index order.
+  //
+  std::reverse(ready.begin(), ready.end());
+
+  order.clear();
+  order.reserve(nb);
+  wave_start.clear();
+
+  while (GetSize(order) < nb) {
+
+    // A loop with several cycles may need more cuts than its cut node : a
+    // node of a loop waiting only for nodes of the same loop is released.
+    // There is always one when nothing is ready since the first blocked
+    // nodes in topological order form a loop.
+    //
+    if (ready.empty()) {
+      ready.push_back(next_loop_release(done));
+      nb_pending[ready.back()] = 0;
+    }
+
+    int n = ready.back();
+    ready.pop_back();
+
+    pull_level(n, &done);
+
+    done[n] = true;
+    order.push_back(n);
+
+    for (int i = fanout_start[n]; i < fanout_start[n + 1]; i++) {
+
+      int fanout = fanout_node[i];
+
+      if (is_cut[fanout] && (loop_id[fanout] == loop_id[n])) {
+        continue;
+      }
+
+      if (!done[fanout] && (nb_pending[fanout] > 0) &&
+          (--nb_pending[fanout] == 0)) {
+        ready.push_back(fanout);
+      }
+    }
+  }
+}
+
+// -------------------------
+// TimingGraph::find_loops
+// -------------------------
+// Iterative Tarjan : the strongly connected components are found in one
+// depth first traversal of the fanouts. A component is a loop if it has
+// several nodes or a node feeding itself.
+//
+void TimingGraph::find_loops() {
+  int nb = nb_nodes();
+
+  loops.clear();
+  loop_cut.clear();
+  loop_id.assign(nb, -1);
+
+  vector<int> index(nb, -1), lowlink(nb, 0);
+  vector<bool> on_stack(nb, false);
+  vector<int> stack;
+
+  // DFS frames : node and next fanout edge to visit.
+  //
+  vector<pair<int, int>> frames;
+
+  int next_index = 0;
+
+  for (int root = 0; root < nb; root++) {
+
+    if (index[root] >= 0) {
+      continue;
+    }
+
+    frames.push_back({root, fanout_start[root]});
+    index[root] = lowlink[root] = next_index++;
+    stack.push_back(root);
+    on_stack[root] = true;
+
+    while (!frames.empty()) {
+
+      int n = frames.back().first;
+      int &edge = frames.back().second;
+
+      if (edge < fanout_start[n + 1]) {
+
+        int fanout = fanout_node[edge++];
+
+        if (index[fanout] < 0) {
+          frames.push_back({fanout, fanout_start[fanout]});
+          index[fanout] = lowlink[fanout] = next_index++;
+          stack.push_back(fanout);
+          on_stack[fanout] = true;
+        } else if (on_stack[fanout]) {
+          lowlink[n] = std::min(lowlink[n], index[fanout]);
+        }
+        continue;
+      }
+
+      frames.pop_back();
+
+      if (!frames.empty()) {
+        int parent = frames.back().first;
+        lowlink[parent] = std::min(lowlink[parent], lowlink[n]);
+      }
+
+      if (lowlink[n] != index[n]) {
+        continue;
+      }
+
+      // 'n' is the root of a component : pop it.
+      //
+      vector<int> component;
+
+      while (true) {
+        int m = stack.back();
+        stack.pop_back();
+        on_stack[m] = false;
+        component.push_back(m);
+        if (m == n) {
+          break;
+        }
+      }
+
+      bool is_loop = (GetSize(component) > 1);
+
+      for (int i = fanout_start[n]; !is_loop && (i < fanout_start[n + 1]);
+           i++) {
+        is_loop = (fanout_node[i] == n);
+      }
+
+      if (!is_loop) {
+        continue;
+      }
+
+      std::sort(component.begin(), component.end());
+
+      for (int m : component) {
+        loop_id[m] = GetSize(loops);
+      }
+
+      loop_cut.push_back(component.front());
+      loops.push_back(component);
+    }
+  }
+}
+
+// -------------------------
+// TimingGraph::next_loop_release
+// -------------------------
+// First node not done of a loop whose fanins not done are all in the same
+// loop.
+//
+int TimingGraph::next_loop_release(const vector<bool> &done) {
+  for (int l = 0; l < GetSize(loops); l++) {
+
+    for (int n : loops[l]) {
+
+      if (done[n]) {
+        continue;
+      }
+
+      bool blocked = false;
+
+      for (int i = fanin_start[n]; i < fanin_start[n + 1]; i++) {
+
+        int fanin = fanin_node[i];
+
+        if (!done[fanin] && (loop_id[fanin] != l)) {
+          blocked = true;
+          break;
+        }
+      }
+
+      if (!blocked) {
+        return n;
+      }
+    }
+  }
+
+  log_error("No loop node to release while levelizing %s.\n",
+            log_id(module));
+}
+
+// -------------------------
+// TimingGraph::report_loops
+// -------------------------
+// One warning per loop with its cells.
+//
+void TimingGraph::report_loops() {
+  for (int l = 0; l < GetSize(loops); l++) {
+
+    log_warning("Detected combinational loop of %d bits in %s, cut at %s.\n",
+                GetSize(loops[l]), log_id(module),
+                log_signal(bits[loop_cut[l]]));
+
+    pool<int> loop_cells;
+
+    for (int n : loops[l]) {
+      for (int i = fanin_start[n]; i < fanin_start[n + 1]; i++) {
+        if (loop_id[fanin_node[i]] == l) {
+          loop_cells.insert(fanin_cell[i]);
+        }
+      }
+    }
+
+    int nb_printed = 0;
+
+    for (int c : loop_cells) {
+
+      if (nb_printed++ == 20) {
+        log("      ... (%d cells)\n", GetSize(loop_cells));
+        break;
+      }
+
+      log("      %s (%s)\n", log_id(cells[c]->name), log_id(cells[c]->type));
+    }
+  }
+
+  if (!loops.empty()) {
+    log("   Found %d combinational loops in %s.\n", GetSize(loops),
+        log_id(module));
+  }
+}
+
+// -------------------------
+// TimingGraph::compute_heights
+// -------------------------
+//
+void TimingGraph::compute_heights(int nb_threads) {
+  if ((nb_threads <= 1) || wave_start.empty()) {
+
+    for (int n : order) {
+      height[n] = (from[n] < 0) ? 0 : height[from[n]] + 1;
+    }
+    return;
+  }
+
+  // The 'from' node of a wave node is in a previous wave.
+  //
+  for (int w = 0; w + 1 < GetSize(wave_start); w++) {
+
+    int first = wave_start[w];
+
+    parallel_for(nb_threads, wave_start[w + 1] - first, min_parallel_nodes,
+                 [&](int, int begin, int end) {
+                   for (int i = first + begin; i < first + end; i++) {
+                     int n = order[i];
+                     height[n] = (from[n] < 0) ? 0 : height[from[n]] + 1;
+                   }
+                 });
+  }
+}
+
+// -------------------------
+// TimingMonitor
+// -------------------------
+//
+TimingMonitor::TimingMonitor(RTLIL::Design *design) : design(design) {
+  design->monitors.insert(this);
+}
+
+// -------------------------
+// TimingMonitor::get
+// -------------------------
+//
+TimingMonitor *TimingMonitor::get(RTLIL::Design *design) {
+  for (auto mon : design->monitors) {
+    TimingMonitor *monitor = dynamic_cast<TimingMonitor *>(mon);
+    if (monitor) {
+      return monitor;
+    }
+  }
+
+  return new TimingMonitor(design);
+}
+
+// -------------------------
+// TimingMonitor::sigmap
+// -------------------------
+//
+SigMap &TimingMonitor::sigmap(RTLIL::Module *module) {
+  check(module);
+
+  ModuleCache &cache = modules[module];
+
+  if (!cache.sigmap_valid) {
+    cache.sigmap.set(module);
+    cache.sigmap_valid = true;
+  }
+
+  return cache.sigmap;
+}
+
+// -------------------------
+// TimingMonitor::levelize
+// -------------------------
+//
+void TimingMonitor::levelize(
+    RTLIL::Module *module, const std::string &kind,
+    const std::function<bool(RTLIL::Cell *)> &traversable,
+    bool with_constants, int nb_threads, bool incremental) {
+  check(module);
+
+  ModuleCache &cache = modules[module];
+  Entry &entry = cache.entries[kind];
+  TimingGraph &graph = entry.graph;
+
+  if (graph.module != module) {
+    entry.valid = false;
+  }
+
+  if (!design->selected_whole_module(module->name)) {
+    entry.valid = false;
+  }
+
+  if (entry.valid && (entry.generation == cache.generation)) {
+    log("   Reusing the timing graph of %s.\n", log_id(module));
+    return;
+  }
+
+  if (entry.valid && incremental) {
+
+    log("   Incremental timing update of %s : %d changed cells.\n",
+        log_id(module), GetSize(entry.changed_cells));
+
+    graph.update(sigmap(module), entry.changed_cells, traversable,
+                 nb_threads);
+
+  } else {
+
+    graph.build(module, sigmap(module), traversable, with_constants);
+    graph.levelize(nb_threads);
+  }
+
+  entry.changed_cells.clear();
+  entry.valid = design->selected_whole_module(module->name);
+  entry.generation = cache.generation;
+}
+
+// -------------------------
+// TimingMonitor::check
+// -------------------------
+// Removed wires and direct writes to 'connections_' are not notified. The
+// cache of 'module' is invalidated if a graph has a bit on a wire gone from
+// the module, or if the cell, wire or connection counts changed while no
+// change was notified.
+//
+void TimingMonitor::check(RTLIL::Module *module) {
+  ModuleCache &cache = modules[module];
+
+  bool stale = (cache.checked_generation == cache.generation) &&
+               ((cache.nb_cells != GetSize(module->cells_)) ||
+                (cache.nb_wires != GetSize(module->wires_)) ||
+                (cache.nb_connections != GetSize(module->connections())));
+
+  if (!stale) {
+
+    pool<RTLIL::Wire *> wires;
+
+    for (auto &it : cache.entries) {
+
+      if (!it.second.valid) {
+        continue;
+      }
+
+      if (wires.empty()) {
+        for (auto wire : module->wires()) {
+          wires.insert(wire);
+        }
+      }
+
+      for (auto bit : it.second.graph.bits) {
+        if (bit.wire && !wires.count(bit.wire)) {
+          stale = true;
+          break;
+        }
+      }
+
+      if (stale) {
+        break;
+      }
+    }
+  }
+
+  if (stale) {
+    invalidate(module);
+  }
+
+  cache.checked_generation = cache.generation;
+  cache.nb_cells = GetSize(module->cells_);
+  cache.nb_wires = GetSize(module->wires_);
+  cache.nb_connections = GetSize(module->connections());
+}
+
+// -------------------------
+// TimingMonitor::invalidate
+// -------------------------
+// The module connections changed : the SigMap and the graph bits are out
+// of date.
+//
+void TimingMonitor::invalidate(RTLIL::Module *module) {
+  auto it = modules.find(module);
+
+  if (it == modules.end()) {
+    return;
+  }
+
+  it->second.generation++;
+  it->second.sigmap_valid = false;
+
+  for (auto &entry : it->second.entries) {
+    entry.second.valid = false;
+    entry.second.changed_cells.clear();
+  }
+}
+
+void TimingMonitor::notify_module_del(RTLIL::Module *module) {
+  modules.erase(module);
+}
+
+void TimingMonitor::notify_blackout(RTLIL::Module *module) {
+  invalidate(module);
+}
+
+// -------------------------
+// TimingMonitor::notify_connect
+// -------------------------
+// Called before the port change is applied : the cell is being removed (or
+// left without connection) when its last port gets disconnected.
+//
+void TimingMonitor::notify_connect(RTLIL::Cell *cell,
+                                   const RTLIL::IdString &port,
+                                   const RTLIL::SigSpec &,
+                                   const RTLIL::SigSpec &sig) {
+  auto it = modules.find(cell->module);
+
+  if (it == modules.end()) {
+    return;
+  }
+
+  it->second.generation++;
+
+  bool alive = !sig.empty() || (GetSize(cell->connections()) > 1) ||
+               !cell->hasPort(port);
+
+  for (auto &entry : it->second.entries) {
+    if (entry.second.valid) {
+      entry.second.changed_cells[cell] = alive;
+    }
+  }
+}
+
+void TimingMonitor::notify_connect(RTLIL::Module *module,
+                                   const RTLIL::SigSig &) {
+  invalidate(module);
+}
+
+void TimingMonitor::notify_connect(RTLIL::Module *module,
+                                   const std::vector<RTLIL::SigSig> &) {
+  invalidate(module);
+}
+
+YOSYS_NAMESPACE_END
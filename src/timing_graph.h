@@ -0,0 +1,264 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef TIMING_GRAPH_H
+#define TIMING_GRAPH_H
+
+#include "kernel/sigtools.h"
+#include "kernel/yosys.h"
+#include <functional>
+
+YOSYS_NAMESPACE_BEGIN
+
+// Below this number of nodes a wave is processed by the calling thread :
+// starting the threads would cost more than the work.
+//
+#define TIMING_GRAPH_MIN_PARALLEL_NODES 4096
+
+// Bit level timing graph shared by 'max_level' and 'max_height'.
+//
+// Nodes are the canonical bits of the selected wires, indexed from 0. The
+// edges from the input bits to the output bits of the traversable cells are
+// stored in compressed sparse row form, both ways, and the node attributes
+// are kept as arrays indexed by node.
+//
+struct TimingGraph {
+  RTLIL::Module *module = nullptr;
+
+  vector<RTLIL::SigBit> bits;
+  dict<RTLIL::SigBit, int> bit2node;
+  vector<bool> is_const;
+
+  // Traversable cells, null once removed from the graph, and their edges
+  // edge_src/dst[cell_edges[c].first .. cell_edges[c].second-1].
+  //
+  vector<RTLIL::Cell *> cells;
+  dict<RTLIL::Cell *, int> cell2idx;
+  vector<pair<int, int>> cell_edges;
+  vector<int> edge_src, edge_dst, edge_cell;
+  bool with_constants = false;
+
+  // Optional delay of the arcs (cell, input port, output port), set before
+  // 'build'. The delay of an edge is the max over the arcs it stands for,
+  // 'fanin_delay' is the CSR view of 'edge_delay'.
+  //
+  std::function<float(RTLIL::Cell *, RTLIL::IdString, RTLIL::IdString)>
+      arc_delay;
+  vector<float> edge_delay, fanin_delay;
+
+  // Fanins of node 'n' : fanin_node/fanin_cell[fanin_start[n] ..
+  // fanin_start[n+1]-1]. Same for fanouts.
+  //
+  vector<int> fanin_start, fanin_node, fanin_cell;
+  vector<int> fanout_start, fanout_node;
+
+  // Node attributes.
+  //
+  //    - level  : longest path from a source
+  //    - from   : fanin node on that path, -1 for a source
+  //    - driver : cell of the edge from 'from', -1 for a source
+  //    - height : length of the 'from' chain
+  //
+  vector<int> level, from, driver, height;
+
+  // Arrival times, filled by 'compute_arrivals' : latest arrival and the
+  // fanin and cell it comes from (-1 for a source).
+  //
+  vector<float> arrival;
+  vector<int> arrival_from, arrival_driver;
+
+  // Required heights, filled by 'compute_required' : the max height a
+  // node can have without increasing the height of the paths it is on.
+  //
+  vector<int> required;
+
+  // Nodes in topological order, filled by 'levelize'. With several
+  // threads, 'order' is made of waves : the nodes of wave 'w' are
+  // order[wave_start[w] .. wave_start[w+1]-1] and only have fanins in the
+  // previous waves. 'wave_start' is empty otherwise.
+  //
+  vector<int> order;
+  vector<int> wave_start;
+
+  // Combinational loops (strongly connected components with a cycle)
+  // found by 'levelize', the node where each loop is cut and the loop of
+  // each node (-1 if none).
+  //
+  vector<vector<int>> loops;
+  vector<int> loop_cut, loop_id;
+  bool has_loops = false;
+
+  // Below this number of nodes a wave is processed by the calling thread.
+  // Set by 'build' from the 'timing_graph.min_parallel_nodes' scratchpad
+  // entry if any (ex: to run the threads on small test designs).
+  //
+  int min_parallel_nodes = TIMING_GRAPH_MIN_PARALLEL_NODES;
+
+  // Build the graph of 'module'. Only the cells for which 'traversable'
+  // returns true get edges. With 'with_constants', constant cell inputs are
+  // nodes too (sources).
+  //
+  void build(RTLIL::Module *module, SigMap &sigmap,
+             const std::function<bool(RTLIL::Cell *)> &traversable,
+             bool with_constants = false);
+
+  // Update the graph after the cells in 'changed' (cell -> still in the
+  // module) were modified, added or removed, then re-propagate the levels through the
+  // fanout cones of their outputs. The graph must have been levelized.
+  //
+  void update(SigMap &sigmap, const dict<RTLIL::Cell *, bool> &changed,
+              const std::function<bool(RTLIL::Cell *)> &traversable,
+              int nb_threads = 1);
+
+  int nb_nodes() const { return GetSize(bits); }
+
+  int node(RTLIL::SigBit bit) const {
+    auto it = bit2node.find(bit);
+    return (it == bit2node.end()) ? -1 : it->second;
+  }
+
+  int nb_fanins(int n) const { return fanin_start[n + 1] - fanin_start[n]; }
+  int nb_fanouts(int n) const { return fanout_start[n + 1] - fanout_start[n]; }
+
+  // Compute 'order', 'level', 'from' and 'driver'. Combinational loops are
+  // found first, reported once each and cut at their first node.
+  //
+  // With 'nb_threads' > 1, the nodes of each wave are processed
+  // concurrently. The attributes are the same as with one thread. Graphs
+  // with loops are levelized with one thread.
+  //
+  void levelize(int nb_threads = 1);
+
+  // Compute 'height' from the 'from' chains, once levelized.
+  //
+  void compute_heights(int nb_threads = 1);
+
+  // Compute the arrival times with the 'arc_delay' delays, once levelized.
+  // 'source_arrival' gives the arrival time of the sources (ex: clock to Q
+  // delay), 0 if missing. Fanins on a cut loop are ignored.
+  //
+  void compute_arrivals(const dict<int, float> &source_arrival);
+
+  // Compute 'required' backward from 'target' at the nodes without
+  // fanouts, once the heights are computed. The slack of node 'n' is then
+  // required[n] - height[n]. Fanouts on a cut loop are ignored.
+  //
+  void compute_required(int target);
+
+  // Fanin with the max level, first one in fanin order on ties.
+  //
+  void pull_level(int n, const vector<bool> *done);
+
+  bool levelize_waves(int nb_threads);
+  void find_loops();
+  void report_loops();
+  int next_loop_release(const vector<bool> &done);
+  bool relevel(const vector<int> &seeds);
+
+  int add_node(RTLIL::SigBit bit);
+  void add_cell(RTLIL::Cell *cell, SigMap &sigmap);
+  void pack();
+
+  RTLIL::Cell *driver_cell(int n) const {
+    return (driver[n] < 0) ? nullptr : cells[driver[n]];
+  }
+};
+
+// Design scoped cache of the timing graphs, shared by 'max_level',
+// 'max_height' and their callers ('report_stat', 'synth_fpga').
+//
+// Each module has a netlist generation counter, bumped by the change
+// notifications : a graph levelized at the current generation is reused
+// as is. Otherwise it is rebuilt or, with '-incremental', updated from the
+// cells whose ports changed since it was levelized. The SigMap of the
+// module is shared too and rebuilt after module connection changes.
+//
+// Changes the notifications do not give (removed wires, partial
+// selections) fall back to a full build.
+//
+struct TimingMonitor : public RTLIL::Monitor {
+  RTLIL::Design *design;
+
+  struct Entry {
+    TimingGraph graph;
+    dict<RTLIL::Cell *, bool> changed_cells;
+    bool valid = false;
+    int generation = -1;
+  };
+
+  struct ModuleCache {
+    int generation = 0;
+    SigMap sigmap;
+    bool sigmap_valid = false;
+
+    // Counts of the module at the last 'check', made at 'checked_generation'.
+    //
+    int checked_generation = -1;
+    int nb_cells = 0, nb_wires = 0, nb_connections = 0;
+
+    // Per graph kind (ex: "max_level -clk2clk").
+    //
+    dict<std::string, Entry> entries;
+  };
+
+  dict<RTLIL::Module *, ModuleCache> modules;
+
+  TimingMonitor(RTLIL::Design *design);
+
+  // Return the monitor attached to 'design', attach it if needed.
+  //
+  static TimingMonitor *get(RTLIL::Design *design);
+
+  TimingGraph &graph(RTLIL::Module *module, const std::string &kind) {
+    return modules[module].entries[kind].graph;
+  }
+
+  SigMap &sigmap(RTLIL::Module *module);
+
+  // Levelize the graph of 'module' for 'kind' : it is reused while the
+  // module does not change, rebuilt (or updated with 'incremental')
+  // otherwise.
+  //
+  void levelize(RTLIL::Module *module, const std::string &kind,
+                const std::function<bool(RTLIL::Cell *)> &traversable,
+                bool with_constants, int nb_threads, bool incremental);
+
+  void notify_module_del(RTLIL::Module *module) override;
+  void notify_blackout(RTLIL::Module *module) override;
+  void notify_connect(RTLIL::Cell *cell, const RTLIL::IdString &port,
+                      const RTLIL::SigSpec &old_sig,
+                      const RTLIL::SigSpec &sig) override;
+  void notify_connect(RTLIL::Module *module,
+                      const RTLIL::SigSig &sigsig) override;
+  void notify_connect(RTLIL::Module *module,
+                      const std::vector<RTLIL::SigSig> &sigsig) override;
+
+  // Invalidate the cache of 'module' on the changes not notified. Done
+  // before using its SigMap or graphs.
+  //
+  void check(RTLIL::Module *module);
+  void invalidate(RTLIL::Module *module);
+};
+
+// Thread count of a '-threads' option : 0 for all the cores.
+//
+int get_nb_threads(const std::string &arg);
+
+YOSYS_NAMESPACE_END
+
+#endif
@@ -0,0 +1,1113 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+// 'zabc' : partitioned ABC mapping.
+//
+// The combinational gates of each selected module are cut into partitions
+// made of the fanin cones of the FFs/ports endpoints. Each partition is
+// written as a BLIF file and mapped by its own ABC process with the given script, several
+// processes running concurrently. The mapped LUTs are then stitched back.
+//
+
+#include "zjobs.h"
+#include "kernel/log.h"
+#include "kernel/register.h"
+#include "kernel/rtlil.h"
+#include "kernel/sigtools.h"
+#include "kernel/yosys.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+USING_YOSYS_NAMESPACE
+PRIVATE_NAMESPACE_BEGIN
+
+// -------------------------
+// gate_models
+// -------------------------
+// Simple gates handed to ABC : input ports in BLIF order and on-set cover.
+//
+typedef struct {
+  vector<IdString> inputs;
+  vector<string> cover;
+} gate_model;
+
+static const dict<IdString, gate_model> &gate_models() {
+  static const dict<IdString, gate_model> models = {
+      {ID($_BUF_), {{ID::A}, {"1"}}},
+      {ID($_NOT_), {{ID::A}, {"0"}}},
+      {ID($_AND_), {{ID::A, ID::B}, {"11"}}},
+      {ID($_NAND_), {{ID::A, ID::B}, {"0-", "-0"}}},
+      {ID($_OR_), {{ID::A, ID::B}, {"1-", "-1"}}},
+      {ID($_NOR_), {{ID::A, ID::B}, {"00"}}},
+      {ID($_XOR_), {{ID::A, ID::B}, {"01", "10"}}},
+      {ID($_XNOR_), {{ID::A, ID::B}, {"00", "11"}}},
+      {ID($_ANDNOT_), {{ID::A, ID::B}, {"10"}}},
+      {ID($_ORNOT_), {{ID::A, ID::B}, {"1-", "-0"}}},
+      {ID($_MUX_), {{ID::A, ID::B, ID::S}, {"1-0", "-11"}}},
+      {ID($_NMUX_), {{ID::A, ID::B, ID::S}, {"0-0", "-01"}}},
+      {ID($_AOI3_), {{ID::A, ID::B, ID::C}, {"0-0", "-00"}}},
+      {ID($_OAI3_), {{ID::A, ID::B, ID::C}, {"00-", "--0"}}},
+      {ID($_AOI4_),
+       {{ID::A, ID::B, ID::C, ID::D}, {"0-0-", "0--0", "-00-", "-0-0"}}},
+      {ID($_OAI4_), {{ID::A, ID::B, ID::C, ID::D}, {"00--", "--00"}}}};
+
+  return models;
+}
+
+// -------------------------
+// ZabcWorker
+// -------------------------
+//
+struct ZabcWorker {
+  Module *module;
+  SigMap sigmap;
+
+  string script_file;
+  string abc_exe;
+  string tempdir;
+  int nb_jobs;
+  int partition_size;
+
+  // Anytime mode : wall clock limits of an ABC process and of one script
+  // line, 0 if none.
+  //
+  double timeout = 0;
+  double step_timeout = 0;
+
+  // LUT size of the part, 0 if unknown : wider '&save' networks are not
+  // used.
+  //
+  int lut_size = 0;
+
+  // Nets are the canonical bits read or driven by gates. Net 0 and 1 are
+  // the constants.
+  //
+  dict<SigBit, int> bit2net;
+  vector<SigBit> net2bit;
+  vector<int> net_driver;
+  vector<bool> net_external;
+  vector<vector<int>> net_readers;
+
+  vector<Cell *> gates;
+  vector<vector<int>> gate_inputs;
+  vector<int> gate_output;
+  vector<int> gate_part;
+
+  typedef struct {
+    vector<int> gates;
+    vector<int> inputs;
+    vector<int> outputs;
+    ZJob job;
+    int nb_luts;
+    // Anytime mode : script line running and when it started.
+    int step;
+    std::chrono::high_resolution_clock::time_point step_start;
+    std::streamoff log_offset;
+  } partition;
+
+  vector<partition> parts;
+
+  // New LUTs and the partition they come from.
+  //
+  dict<Cell *, int> lut_part;
+
+  ZabcWorker(Module *module) : module(module), sigmap(module) {}
+
+  // -------------------------
+  // get_net
+  // -------------------------
+  //
+  int get_net(SigBit bit) {
+    bit = sigmap(bit);
+
+    if (!bit.wire) {
+      return (bit == State::S1) ? 1 : 0;
+    }
+
+    auto it = bit2net.find(bit);
+    if (it != bit2net.end()) {
+      return it->second;
+    }
+
+    int net = GetSize(net2bit);
+
+    bit2net[bit] = net;
+    net2bit.push_back(bit);
+    net_driver.push_back(-1);
+    net_external.push_back(false);
+    net_readers.push_back(vector<int>());
+
+    return net;
+  }
+
+  void mark_external(SigSpec sig) {
+    for (auto bit : sigmap(sig)) {
+      auto it = bit2net.find(bit);
+      if (it != bit2net.end()) {
+        net_external[it->second] = true;
+      }
+    }
+  }
+
+  // -------------------------
+  // extract_gates
+  // -------------------------
+  //
+  void extract_gates() {
+    for (int i = 0; i < 2; i++) {
+      net2bit.push_back(SigBit(i ? State::S1 : State::S0));
+      net_driver.push_back(-1);
+      net_external.push_back(false);
+      net_readers.push_back(vector<int>());
+    }
+
+    const dict<IdString, gate_model> &models = gate_models();
+
+    for (auto cell : module->cells()) {
+
+      if (!models.count(cell->type) || cell->has_keep_attr()) {
+        continue;
+      }
+
+      int out = get_net(cell->getPort(ID::Y));
+
+      // Gate driving a constant : left to 'opt'.
+      //
+      if (out < 2) {
+        continue;
+      }
+
+      int g = GetSize(gates);
+
+      gates.push_back(cell);
+      gate_inputs.push_back(vector<int>());
+      gate_output.push_back(out);
+      net_driver[out] = g;
+
+      for (auto port : models.at(cell->type).inputs) {
+        int net = get_net(cell->getPort(port));
+        gate_inputs[g].push_back(net);
+        net_readers[net].push_back(g);
+      }
+    }
+
+    // Nets used by anything else than a gate must stay visible.
+    //
+    pool<Cell *> gate_set(gates.begin(), gates.end());
+
+    for (auto cell : module->cells()) {
+      if (gate_set.count(cell)) {
+        continue;
+      }
+      for (auto &conn : cell->connections()) {
+        mark_external(conn.second);
+      }
+    }
+
+    for (auto wire : module->wires()) {
+      if (wire->port_output || wire->get_bool_attribute(ID::keep)) {
+        mark_external(SigSpec(wire));
+      }
+    }
+  }
+
+  // -------------------------
+  // build_partitions
+  // -------------------------
+  // Pack the fanin cones of the endpoints into partitions of about
+  // 'partition_size' gates. A cone is only cut when it exceeds twice that
+  // size.
+  //
+  void build_partitions() {
+    gate_part.assign(GetSize(gates), -1);
+
+    int part = 0;
+    int size = 0;
+
+    auto collect_cone = [&](int root) {
+      vector<int> stack = {root};
+
+      while (!stack.empty()) {
+        int g = stack.back();
+        stack.pop_back();
+
+        if (gate_part[g] >= 0) {
+          continue;
+        }
+
+        gate_part[g] = part;
+        size++;
+
+        if (size >= 2 * partition_size) {
+          part++;
+          size = 0;
+        }
+
+        for (int net : gate_inputs[g]) {
+          int driver = net_driver[net];
+          if ((driver >= 0) && (gate_part[driver] < 0)) {
+            stack.push_back(driver);
+          }
+        }
+      }
+
+      if (size >= partition_size) {
+        part++;
+        size = 0;
+      }
+    };
+
+    for (int net = 2; net < GetSize(net2bit); net++) {
+      int driver = net_driver[net];
+      if (net_external[net] && (driver >= 0) && (gate_part[driver] < 0)) {
+        collect_cone(driver);
+      }
+    }
+
+    // Dangling logic : ABC will remove it.
+    //
+    for (int g = 0; g < GetSize(gates); g++) {
+      if (gate_part[g] < 0) {
+        collect_cone(g);
+      }
+    }
+
+    parts.resize(size ? part + 1 : part);
+
+    for (int g = 0; g < GetSize(gates); g++) {
+      parts[gate_part[g]].gates.push_back(g);
+    }
+
+    for (int p = 0; p < GetSize(parts); p++) {
+
+      pool<int> inputs, outputs;
+
+      for (int g : parts[p].gates) {
+
+        for (int net : gate_inputs[g]) {
+          int driver = net_driver[net];
+          if ((net >= 2) && ((driver < 0) || (gate_part[driver] != p))) {
+            inputs.insert(net);
+          }
+        }
+
+        int out = gate_output[g];
+
+        if (net_external[out]) {
+          outputs.insert(out);
+          continue;
+        }
+        for (int reader : net_readers[out]) {
+          if (gate_part[reader] != p) {
+            outputs.insert(out);
+            break;
+          }
+        }
+      }
+
+      parts[p].inputs.assign(inputs.begin(), inputs.end());
+      parts[p].outputs.assign(outputs.begin(), outputs.end());
+      parts[p].nb_luts = 0;
+      parts[p].step = 0;
+      parts[p].log_offset = 0;
+    }
+  }
+
+  static string net_name(int net) { return stringf("zabc_n%d", net); }
+
+  // -------------------------
+  // write_partition
+  // -------------------------
+  //
+  void write_partition(int p) {
+    partition &part = parts[p];
+
+    std::ofstream blif(part.job.dir + "/input.blif");
+
+    blif << ".model zabc\n";
+
+    blif << ".inputs";
+    for (int net : part.inputs) {
+      blif << " " << net_name(net);
+    }
+    blif << "\n";
+
+    blif << ".outputs";
+    for (int net : part.outputs) {
+      blif << " " << net_name(net);
+    }
+    blif << "\n";
+
+    blif << ".names " << net_name(0) << "\n";
+    blif << ".names " << net_name(1) << "\n1\n";
+
+    const dict<IdString, gate_model> &models = gate_models();
+
+    for (int g : part.gates) {
+
+      blif << ".names";
+      for (int net : gate_inputs[g]) {
+        blif << " " << net_name(net);
+      }
+      blif << " " << net_name(gate_output[g]) << "\n";
+
+      for (auto &cube : models.at(gates[g]->type).cover) {
+        blif << cube << " 1\n";
+      }
+    }
+
+    blif << ".end\n";
+    blif.close();
+
+    std::ofstream script(part.job.dir + "/abc.script");
+    script << "read_blif input.blif\n";
+    if (anytime()) {
+      script << "source " << tempdir << "/anytime.script\n";
+    } else {
+      script << "source " << script_file << "\n";
+    }
+    script << "write_blif output.blif\n";
+    script.close();
+  }
+
+  bool anytime() { return (timeout > 0) || (step_timeout > 0); }
+
+  // -------------------------
+  // write_anytime_script
+  // -------------------------
+  // Copy of the script where each line is announced by a 'zabc_step <line>'
+  // message, and where the network is written to 'saved.blif' after each
+  // '&save', so that a stopped ABC still leaves a mapped network.
+  //
+  // The '-K' of the last mapping before a '&save' is followed through the
+  // '&save'/'&load' pairs : networks mapped with LUTs wider than 'lut_size'
+  // (ex: '&if -K 7' intermediate steps) are not written.
+  //
+  void write_anytime_script() {
+    std::ifstream in(script_file);
+    std::ofstream out(tempdir + "/anytime.script");
+
+    string line;
+    int line_nb = 0;
+    int current_k = 0;
+    int saved_k = 0;
+
+    while (std::getline(in, line)) {
+
+      line_nb++;
+
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+
+      std::istringstream words(line);
+      string first;
+      words >> first;
+
+      if (first.empty() || (first[0] == '#') || (first == "echo") ||
+          (first == "time")) {
+        out << line << "\n";
+        continue;
+      }
+
+      out << "echo \"zabc_step " << line_nb << "\"\n";
+
+      for (auto &command : split_tokens(line, ";")) {
+
+        out << command << "\n";
+
+        std::istringstream command_words(command);
+        string name, word;
+        command_words >> name;
+
+        while (command_words >> word) {
+          if ((word == "-K") && (command_words >> word)) {
+            current_k = atoi(word.c_str());
+          }
+        }
+
+        if (name == "&load") {
+          current_k = saved_k;
+        }
+
+        if (name == "&save") {
+          saved_k = current_k;
+
+          if (!lut_size || (current_k <= lut_size)) {
+            out << "&put\n";
+            out << "write_blif saved.blif\n";
+          }
+        }
+      }
+    }
+  }
+
+  // -------------------------
+  // script_line
+  // -------------------------
+  //
+  string script_line(int line_nb) {
+    std::ifstream in(script_file);
+    string line;
+
+    for (int i = 0; i < line_nb && std::getline(in, line); i++) {
+    }
+
+    return line;
+  }
+
+  // -------------------------
+  // check_step
+  // -------------------------
+  // Watchdog of partition 'p' : follow the 'zabc_step' messages in its log
+  // and return true if the current line runs for more than 'step_timeout'.
+  //
+  bool check_step(int p) {
+    partition &part = parts[p];
+
+    auto now = std::chrono::high_resolution_clock::now();
+
+    std::ifstream log_file(part.job.dir + "/abc.log");
+
+    if (log_file.is_open()) {
+
+      log_file.seekg(part.log_offset);
+
+      string line;
+
+      while (std::getline(log_file, line)) {
+
+        if (line.compare(0, 10, "zabc_step ") == 0) {
+          part.step = atoi(line.c_str() + 10);
+          part.step_start = now;
+        }
+
+        if (!log_file.eof()) {
+          part.log_offset = log_file.tellg();
+        }
+      }
+    }
+
+    return (part.step > 0) &&
+           (std::chrono::duration<double>(now - part.step_start).count() >
+            step_timeout);
+  }
+
+  // -------------------------
+  // run_jobs
+  // -------------------------
+  // ABC is run from the partition directory since some scripts write and
+  // read back intermediate BLIF files in the current directory.
+  //
+  void run_jobs() {
+    vector<ZJob *> jobs;
+
+    // The step watchdog reads the ABC log while it is written : ask for a
+    // line buffered output.
+    //
+    string stdbuf;
+    if ((step_timeout > 0) && check_file_exists("/usr/bin/stdbuf", true)) {
+      stdbuf = "/usr/bin/stdbuf -oL ";
+    }
+
+    for (auto &part : parts) {
+      if (part.outputs.empty()) {
+        part.job.success = true;
+        continue;
+      }
+      part.job.command = stdbuf + zjob_quote(abc_exe) +
+                         " -s -f abc.script > abc.log 2>&1";
+      part.job.timeout = timeout;
+      if (step_timeout > 0) {
+        int p = &part - &parts[0];
+        part.job.watchdog = [this, p](ZJob &) { return check_step(p); };
+      }
+      jobs.push_back(&part.job);
+    }
+
+    zjob_run_all(jobs, nb_jobs);
+  }
+
+  // -------------------------
+  // read_partition
+  // -------------------------
+  // Read back the mapped BLIF and create the LUTs. Return false if the file
+  // cannot be used, in which case the partition gates are kept.
+  //
+  bool read_partition(int p, const string &file = "output.blif") {
+    partition &part = parts[p];
+
+    std::ifstream blif(part.job.dir + "/" + file);
+
+    if (!blif.is_open()) {
+      return false;
+    }
+
+    dict<string, SigBit> name2bit;
+
+    for (int net : part.inputs) {
+      name2bit[net_name(net)] = net2bit[net];
+    }
+    for (int net : part.outputs) {
+      name2bit[net_name(net)] = net2bit[net];
+    }
+    name2bit[net_name(0)] = State::S0;
+    name2bit[net_name(1)] = State::S1;
+
+    auto get_bit = [&](const string &name) {
+      auto it = name2bit.find(name);
+      if (it != name2bit.end()) {
+        return it->second;
+      }
+      SigBit bit = module->addWire(NEW_ID);
+      name2bit[name] = bit;
+      return bit;
+    };
+
+    // Parse the nodes first, cells are created once the file is known to be
+    // complete.
+    //
+    typedef struct {
+      vector<string> signals;
+      vector<string> cubes;
+    } blif_node;
+
+    vector<blif_node> nodes;
+    bool ended = false;
+    string line, pending;
+
+    while (std::getline(blif, line)) {
+
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty() && line.back() == '\\') {
+        pending += line.substr(0, line.size() - 1) + " ";
+        continue;
+      }
+      line = pending + line;
+      pending.clear();
+
+      std::istringstream tokens(line);
+      vector<string> words;
+      string word;
+
+      while (tokens >> word) {
+        if (word[0] == '#') {
+          break;
+        }
+        words.push_back(word);
+      }
+
+      if (words.empty()) {
+        continue;
+      }
+
+      if (words[0] == ".names") {
+        nodes.push_back(blif_node());
+        nodes.back().signals.assign(words.begin() + 1, words.end());
+        continue;
+      }
+
+      if (words[0] == ".end") {
+        ended = true;
+        break;
+      }
+
+      if (words[0][0] == '.') {
+        if ((words[0] == ".latch") || (words[0] == ".subckt") ||
+            (words[0] == ".gate")) {
+          return false;
+        }
+        continue;
+      }
+
+      if (nodes.empty()) {
+        return false;
+      }
+
+      nodes.back().cubes.push_back(line);
+    }
+
+    if (!ended) {
+      return false;
+    }
+
+    // All the partition outputs must be driven.
+    //
+    pool<string> driven;
+    for (auto &node : nodes) {
+      if (!node.signals.empty()) {
+        driven.insert(node.signals.back());
+      }
+    }
+    for (int net : part.outputs) {
+      if (!driven.count(net_name(net))) {
+        return false;
+      }
+    }
+
+    // Truth tables, LUT bit 'i' is the value for inputs 'i' (input 'j' is
+    // bit 'j').
+    //
+    vector<vector<State>> tables;
+
+    for (auto &node : nodes) {
+
+      if (node.signals.empty()) {
+        return false;
+      }
+
+      int nb_inputs = GetSize(node.signals) - 1;
+
+      if (nb_inputs > (lut_size ? lut_size : 16)) {
+        return false;
+      }
+
+      vector<State> table(1 << nb_inputs, State::S0);
+      bool offset_cover = false;
+
+      for (auto &cube : node.cubes) {
+
+        std::istringstream tokens(cube);
+        string in, out;
+
+        if (nb_inputs > 0) {
+          tokens >> in;
+        }
+        tokens >> out;
+
+        if ((GetSize(in) != nb_inputs) || (out.size() != 1)) {
+          return false;
+        }
+
+        offset_cover = (out == "0");
+
+        for (int i = 0; i < GetSize(table); i++) {
+          bool match = true;
+          for (int j = 0; j < nb_inputs && match; j++) {
+            bool value = (i >> j) & 1;
+            match = (in[j] == '-') || ((in[j] == '1') == value);
+          }
+          if (match) {
+            table[i] = State::S1;
+          }
+        }
+      }
+
+      if (offset_cover) {
+        for (auto &bit : table) {
+          bit = (bit == State::S1) ? State::S0 : State::S1;
+        }
+      }
+
+      tables.push_back(table);
+    }
+
+    for (int n = 0; n < GetSize(nodes); n++) {
+
+      blif_node &node = nodes[n];
+      vector<State> &table = tables[n];
+
+      int nb_inputs = GetSize(node.signals) - 1;
+
+      SigBit out = get_bit(node.signals.back());
+
+      if (nb_inputs == 0) {
+        module->connect(out, table[0]);
+        continue;
+      }
+
+      SigSpec inputs;
+      for (int j = 0; j < nb_inputs; j++) {
+        inputs.append(get_bit(node.signals[j]));
+      }
+
+      // Buffer : just connect.
+      //
+      if ((nb_inputs == 1) && (table[0] == State::S0) &&
+          (table[1] == State::S1)) {
+        module->connect(out, inputs);
+        continue;
+      }
+
+      Cell *lut = module->addLut(NEW_ID, inputs, out, Const(table));
+      lut_part[lut] = p;
+      part.nb_luts++;
+    }
+
+    return true;
+  }
+
+  // -------------------------
+  // report_depth
+  // -------------------------
+  // Max LUT depth over the whole module, so that paths going through
+  // several partitions are taken into account.
+  //
+  void report_depth() {
+    SigMap lut_sigmap(module);
+
+    vector<Cell *> luts;
+    dict<SigBit, int> bit2lut;
+
+    for (auto cell : module->cells()) {
+      if (cell->type == ID($lut)) {
+        bit2lut[lut_sigmap(cell->getPort(ID::Y))] = GetSize(luts);
+        luts.push_back(cell);
+      }
+    }
+
+    int nb_luts = GetSize(luts);
+
+    vector<vector<int>> fanouts(nb_luts);
+    vector<int> nb_fanins(nb_luts, 0);
+
+    for (int l = 0; l < nb_luts; l++) {
+      for (auto bit : lut_sigmap(luts[l]->getPort(ID::A))) {
+        auto it = bit2lut.find(bit);
+        if (it != bit2lut.end()) {
+          fanouts[it->second].push_back(l);
+          nb_fanins[l]++;
+        }
+      }
+    }
+
+    vector<int> depth(nb_luts, 1);
+    vector<int> crossings(nb_luts, 0);
+    vector<int> part(nb_luts, -1);
+    vector<int> ready;
+
+    for (int l = 0; l < nb_luts; l++) {
+      part[l] = lut_part.count(luts[l]) ? lut_part.at(luts[l]) : -1;
+      if (nb_fanins[l] == 0) {
+        ready.push_back(l);
+      }
+    }
+
+    int max_depth = 0;
+    int max_crossings = 0;
+
+    while (!ready.empty()) {
+      int l = ready.back();
+      ready.pop_back();
+
+      if ((depth[l] > max_depth) ||
+          ((depth[l] == max_depth) && (crossings[l] > max_crossings))) {
+        max_depth = depth[l];
+        max_crossings = crossings[l];
+      }
+
+      for (int f : fanouts[l]) {
+        int cross = crossings[l] + (part[l] != part[f] ? 1 : 0);
+        if ((depth[l] + 1 > depth[f]) ||
+            ((depth[l] + 1 == depth[f]) && (cross > crossings[f]))) {
+          depth[f] = depth[l] + 1;
+          crossings[f] = cross;
+        }
+        if (--nb_fanins[f] == 0) {
+          ready.push_back(f);
+        }
+      }
+    }
+
+    log("\n   Max LUT depth : %d (critical path crosses %d partition "
+        "boundaries)\n",
+        max_depth, max_crossings);
+
+    module->design->scratchpad_set_int("zabc.max_depth", max_depth);
+  }
+
+  // -------------------------
+  // run
+  // -------------------------
+  // Return false if some partitions could not be mapped.
+  //
+  bool run() {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    extract_gates();
+
+    if (gates.empty()) {
+      log("   No gates to map in module %s.\n", log_id(module->name));
+      return true;
+    }
+
+    if (partition_size <= 0) {
+      partition_size = std::max(1000, (GetSize(gates) + nb_jobs - 1) / nb_jobs);
+    }
+
+    build_partitions();
+
+    log("   Mapping %d gates in %d partitions with %d jobs.\n", GetSize(gates),
+        GetSize(parts), nb_jobs);
+
+    if (anytime()) {
+      write_anytime_script();
+    }
+
+    for (int p = 0; p < GetSize(parts); p++) {
+      parts[p].job.dir = stringf("%s/p%d", tempdir.c_str(), p);
+      create_directory(parts[p].job.dir);
+      write_partition(p);
+    }
+
+    run_jobs();
+
+    int nb_failed = 0;
+
+    log("\n");
+    log("   %9s %9s %9s %9s %9s %9s\n", "partition", "gates", "inputs",
+        "outputs", "luts", "time (s)");
+
+    for (int p = 0; p < GetSize(parts); p++) {
+
+      partition &part = parts[p];
+
+      bool mapped = part.outputs.empty() ||
+                    (part.job.success && read_partition(p));
+
+      // Anytime mode : continue with the last saved network.
+      //
+      if (!mapped && part.job.timed_out) {
+
+        // Catch the last step messages.
+        //
+        check_step(p);
+
+        log_warning("ABC stopped after %.1f sec. on partition %d during "
+                    "script line %d '%s'.\n",
+                    part.job.runtime, p, part.step,
+                    script_line(part.step).c_str());
+
+        module->design->scratchpad_set_bool("zabc.timed_out", true);
+
+        mapped = read_partition(p, "saved.blif");
+
+        if (mapped) {
+          log("   Partition %d : using the last '&save' network.\n", p);
+        }
+      }
+
+      if (!mapped) {
+        log_warning("ABC failed on partition %d, gates are kept (see "
+                    "'%s/abc.log').\n",
+                    p, part.job.dir.c_str());
+        nb_failed++;
+        continue;
+      }
+
+      for (int g : part.gates) {
+        module->remove(gates[g]);
+      }
+
+      log("   %9d %9d %9d %9d %9d %9.1f\n", p, GetSize(part.gates),
+          GetSize(part.inputs), GetSize(part.outputs), part.nb_luts,
+          part.job.runtime);
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration<double>(endTime - startTime);
+
+    log("\n   Partitioned ABC run time = %.1f sec.\n", elapsed.count());
+
+    report_depth();
+
+    return nb_failed == 0;
+  }
+};
+
+struct ZabcPass : public Pass {
+  ZabcPass()
+      : Pass("zabc", "partitioned ABC mapping with concurrent ABC processes") {}
+
+  void help() override {
+    //   |---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|---v---|
+    log("\n");
+    log("    zabc -script <file> [options] [selection]\n");
+    log("\n");
+    log("This command cuts the combinational gates of each selected module "
+        "into\n");
+    log("partitions made of the fanin cones of FFs and ports, maps each "
+        "partition into\n");
+    log("LUTs with its own ABC process running <file> and stitches the LUTs "
+        "back.\n");
+    log("Partitions are mapped concurrently. The max LUT depth reported at "
+        "the end\n");
+    log("takes into account the paths crossing partitions.\n");
+    log("\n");
+    log("    -script <file>\n");
+    log("        ABC script to run on each partition (the script has to do "
+        "the\n");
+    log("        LUT mapping).\n");
+    log("\n");
+    log("    -jobs <N>\n");
+    log("        number of ABC processes running at the same time. Default is "
+        "1.\n");
+    log("\n");
+    log("    -partition_size <N>\n");
+    log("        approximate number of gates per partition. By default the "
+        "gates are\n");
+    log("        spread over <N> jobs partitions with at least 1000 gates "
+        "each.\n");
+    log("\n");
+    log("    -timeout <sec>\n");
+    log("        stop an ABC process after <sec> seconds and use the network "
+        "of its\n");
+    log("        last '&save' command.\n");
+    log("\n");
+    log("    -step_timeout <sec>\n");
+    log("        same but for a single line of the script.\n");
+    log("\n");
+    log("    -lut <K>\n");
+    log("        with -timeout or -step_timeout, partitions stopped before any "
+        "'&save'\n");
+    log("        of a network mapped with K-input LUTs at most are mapped by "
+        "'abc -fast\n");
+    log("        -lut <K>' instead of the script.\n");
+    log("\n");
+    log("    -nocleanup\n");
+    log("        keep the temporary directory with the ABC files.\n");
+    log("\n");
+    log("If the ABC executable cannot be found, 'abc -script <file>' is "
+        "called instead.\n");
+    log("\n");
+  }
+
+  void execute(std::vector<std::string> args, RTLIL::Design *design) override {
+    string script_file;
+    int nb_jobs = 1;
+    int partition_size = 0;
+    bool cleanup = true;
+    double timeout = 0;
+    double step_timeout = 0;
+    string lut_size;
+
+    log_header(design, "Executing 'zabc' partitioned ABC mapping.\n");
+
+    size_t argidx;
+    for (argidx = 1; argidx < args.size(); argidx++) {
+      if (args[argidx] == "-script" && argidx + 1 < args.size()) {
+        script_file = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-jobs" && argidx + 1 < args.size()) {
+        nb_jobs = std::max(1, atoi(args[++argidx].c_str()));
+        continue;
+      }
+      if (args[argidx] == "-partition_size" && argidx + 1 < args.size()) {
+        partition_size = atoi(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-timeout" && argidx + 1 < args.size()) {
+        timeout = atof(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-step_timeout" && argidx + 1 < args.size()) {
+        step_timeout = atof(args[++argidx].c_str());
+        continue;
+      }
+      if (args[argidx] == "-lut" && argidx + 1 < args.size()) {
+        lut_size = args[++argidx];
+        continue;
+      }
+      if (args[argidx] == "-nocleanup") {
+        cleanup = false;
+        continue;
+      }
+      break;
+    }
+    extra_args(args, argidx, design);
+
+    if (script_file.empty()) {
+      log_cmd_error("Missing -script option.\n");
+    }
+
+    vector<Module *> modules = design->selected_modules();
+
+    if (modules.empty()) {
+      log_warning("Design seems empty !\n");
+      return;
+    }
+
+    string resolved_script = script_file;
+    rewrite_filename(resolved_script);
+
+    if (!check_file_exists(resolved_script)) {
+      log_cmd_error("Cannot find ABC script '%s'.\n", resolved_script.c_str());
+    }
+
+    // ABC runs from its own directory.
+    //
+    resolved_script = std::filesystem::absolute(resolved_script).string();
+
+    string abc_exe = yosys_abc_executable;
+    if (abc_exe.empty()) {
+      abc_exe = proc_self_dirname() + proc_program_prefix() + "yosys-abc";
+    }
+
+    if (!check_file_exists(abc_exe, true)) {
+      log_warning("Cannot find ABC executable '%s', calling 'abc -script'.\n",
+                  abc_exe.c_str());
+      Pass::call(design, "abc -script " + script_file);
+      return;
+    }
+
+    design->scratchpad_unset("zabc.timed_out");
+
+    for (auto module : modules) {
+
+      ZabcWorker worker(module);
+
+      worker.script_file = resolved_script;
+      worker.abc_exe = abc_exe;
+      worker.nb_jobs = nb_jobs;
+      worker.partition_size = partition_size;
+      worker.timeout = timeout;
+      worker.step_timeout = step_timeout;
+      worker.lut_size = atoi(lut_size.c_str());
+      worker.tempdir = make_temp_dir(get_base_tmpdir() + "/yosys-zabc-XXXXXX");
+
+      bool success = worker.run();
+
+      if (cleanup && success) {
+        remove_directory(worker.tempdir);
+      } else {
+        log("\n   ABC files kept in '%s'\n", worker.tempdir.c_str());
+      }
+
+      // Map the gates of the failing partitions.
+      //
+      if (!success && worker.anytime() && !lut_size.empty()) {
+        log_warning("Partitioned ABC failed on %s, calling 'abc -fast -lut "
+                    "%s'.\n",
+                    log_id(module->name), lut_size.c_str());
+        Pass::call(design, stringf("abc -fast -lut %s %s", lut_size.c_str(),
+                                   log_id(module->name)));
+      } else if (!success) {
+        log_warning("Partitioned ABC failed on %s, calling 'abc -script'.\n",
+                    log_id(module->name));
+        Pass::call(design, stringf("abc -script %s %s", script_file.c_str(),
+                                   log_id(module->name)));
+      }
+    }
+  }
+} ZabcPass;
+
+PRIVATE_NAMESPACE_END
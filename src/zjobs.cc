@@ -0,0 +1,176 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#include "zjobs.h"
+#include "kernel/log.h"
+#include <thread>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
+#endif
+
+YOSYS_NAMESPACE_BEGIN
+
+string zjob_quote(const string &path) {
+#ifdef _WIN32
+  return "\"" + path + "\"";
+#else
+  string res = "'";
+  for (char ch : path) {
+    if (ch == '\'') {
+      res += "'\\''";
+    } else {
+      res += ch;
+    }
+  }
+  return res + "'";
+#endif
+}
+
+// -------------------------
+// zjob_spawn
+// -------------------------
+// On Windows the job runs synchronously.
+//
+void zjob_spawn(ZJob &job) {
+#ifdef _WIN32
+  string command = "cd /d " + zjob_quote(job.dir) + " && " + job.command;
+#else
+  string command = "cd " + zjob_quote(job.dir) + " && exec " + job.command;
+#endif
+
+  job.start = std::chrono::high_resolution_clock::now();
+  job.running = true;
+  job.success = false;
+  job.timed_out = false;
+
+#ifdef _WIN32
+  job.success = (run_command(command) == 0);
+  job.running = false;
+  job.runtime = std::chrono::duration<double>(
+                    std::chrono::high_resolution_clock::now() - job.start)
+                    .count();
+#else
+  const char *argv[] = {"/bin/sh", "-c", command.c_str(), nullptr};
+
+  // With a timeout or a watchdog, the job gets its own process group so
+  // that the processes it launches are killed with it.
+  //
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+
+  if ((job.timeout > 0) || job.watchdog) {
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+  }
+
+  if (posix_spawn(&job.pid, "/bin/sh", nullptr, &attr, (char **)argv,
+                  environ) != 0) {
+    log_warning("Cannot launch '%s'.\n", command.c_str());
+    job.running = false;
+  }
+
+  posix_spawnattr_destroy(&attr);
+#endif
+}
+
+// -------------------------
+// zjob_wait
+// -------------------------
+//
+bool zjob_wait(ZJob &job, bool block) {
+  if (!job.running) {
+    return true;
+  }
+
+#ifndef _WIN32
+  // Poll so that the timeout is checked.
+  //
+  if (block && ((job.timeout > 0) || job.watchdog)) {
+    while (!zjob_wait(job, false)) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+  }
+
+  int status;
+
+  pid_t pid = waitpid(job.pid, &status, block ? 0 : WNOHANG);
+
+  if ((pid == 0) &&
+      (((job.timeout > 0) &&
+        (std::chrono::duration<double>(
+             std::chrono::high_resolution_clock::now() - job.start)
+             .count() > job.timeout)) ||
+       (job.watchdog && job.watchdog(job)))) {
+    kill(-job.pid, SIGKILL);
+    pid = waitpid(job.pid, &status, 0);
+    job.timed_out = true;
+  }
+
+  if (pid == 0) {
+    return false;
+  }
+
+  job.running = false;
+  job.success = !job.timed_out && (pid == job.pid) && WIFEXITED(status) &&
+                (WEXITSTATUS(status) == 0);
+  job.runtime = std::chrono::duration<double>(
+                    std::chrono::high_resolution_clock::now() - job.start)
+                    .count();
+#endif
+
+  return true;
+}
+
+// -------------------------
+// zjob_run_all
+// -------------------------
+//
+void zjob_run_all(const vector<ZJob *> &jobs, int nb_parallel) {
+  vector<ZJob *> running;
+  size_t next = 0;
+
+  while ((next < jobs.size()) || !running.empty()) {
+
+    while ((next < jobs.size()) && (GetSize(running) < nb_parallel)) {
+      zjob_spawn(*jobs[next]);
+      running.push_back(jobs[next++]);
+    }
+
+    bool progress = false;
+
+    for (size_t i = 0; i < running.size();) {
+      if (zjob_wait(*running[i], false)) {
+        running.erase(running.begin() + i);
+        progress = true;
+        continue;
+      }
+      i++;
+    }
+
+    if (!progress && !running.empty()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+}
+
+YOSYS_NAMESPACE_END
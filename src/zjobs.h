@@ -0,0 +1,68 @@
+//
+//  Copyright (C) 2025  Thierry Besson <thierry@zeroasic.com>, Zero Asic Corp.
+//
+/*
+ *  Permission to use, copy, modify, and/or distribute this software for any
+ *  purpose with or without fee is hereby granted, provided that the above
+ *  copyright notice and this permission notice appear in all copies.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ *  WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ *  MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ *  ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ *  WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ *  ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ *  OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+#ifndef ZJOBS_H
+#define ZJOBS_H
+
+#include "kernel/yosys.h"
+#include <chrono>
+#include <functional>
+#include <sys/types.h>
+
+YOSYS_NAMESPACE_BEGIN
+
+// External process (ex: 'yosys-abc', 'yosys' workers) run by the shell from
+// its own directory, so that processes running at the same time do not
+// share files.
+//
+struct ZJob {
+  string dir;
+  string command;
+#ifndef _WIN32
+  pid_t pid = 0;
+#endif
+  bool running = false;
+  bool success = false;
+  // Wall clock limit in seconds, 0 if none. The job and its children are
+  // killed when it expires.
+  double timeout = 0;
+  bool timed_out = false;
+  // Called while the job runs, the job is killed as on timeout if it
+  // returns true.
+  std::function<bool(ZJob &)> watchdog;
+  std::chrono::high_resolution_clock::time_point start;
+  double runtime = 0;
+};
+
+// Quote a path for the shell running the jobs.
+//
+extern string zjob_quote(const string &path);
+
+extern void zjob_spawn(ZJob &job);
+
+// Return true if 'job' is over.
+//
+extern bool zjob_wait(ZJob &job, bool block);
+
+// Run 'jobs' with at most 'nb_parallel' of them at the same time.
+//
+extern void zjob_run_all(const vector<ZJob *> &jobs, int nb_parallel);
+
+YOSYS_NAMESPACE_END
+
+#endif